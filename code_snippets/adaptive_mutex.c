@@ -0,0 +1,239 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/*
+ * Adaptive Mutex: Spin First, Then Sleep (Linux futex)
+ *
+ * race_condition_mutex.c shows WHAT a mutex does. On a real multi-core host
+ * the question is HOW to wait when it's taken:
+ * - Spinning (test-and-set): no syscall, but burns CPU, and is terrible if
+ *   the holder got preempted.
+ * - Sleeping (pthread_mutex / futex): no wasted CPU, but every sleep and
+ *   wake is a syscall (~1-5 us) -> way more than a 20 ns critical section.
+ * - Adaptive: spin for a short while with exponential backoff (the holder is
+ *   probably about to release it), and only THEN park on the futex.
+ *
+ * Futex state (Drepper, "Futexes Are Tricky"):
+ *   0 = unlocked, 1 = locked (no sleepers), 2 = locked, someone may be asleep
+ * The unlock path only makes a syscall when the state was 2.
+ *
+ * Watch the runs with more threads than cores: a spinner can burn the whole
+ * time slice while the holder is preempted, which is where parking pays off.
+ *
+ * Build: gcc -O2 -pthread adaptive_mutex.c -o adaptive_mutex
+ * Run:   ./adaptive_mutex [increments_per_thread]
+ */
+
+#define SPIN_LIMIT       100  // Spin attempts before parking
+#define BACKOFF_MAX      64   // Max pause instructions between attempts
+#define HOLD_SAMPLE_RATE 16   // Time 1 in N critical sections (timing isn't free)
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static long futex_wait(atomic_int *addr, int expected) {
+    return syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static long futex_wake(atomic_int *addr, int count) {
+    return syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+// --- Adaptive spin-then-park mutex ---
+
+typedef struct {
+    atomic_int state;              // 0 / 1 / 2 (see above)
+
+    // Stats: slow-path counters are atomics, the rest is only touched by the holder
+    atomic_uint_fast64_t contended;    // Fast path failed
+    atomic_uint_fast64_t spin_success; // ...but spinning got it
+    atomic_uint_fast64_t parked;       // ...had to sleep in the kernel
+    uint64_t acquisitions;
+    uint64_t hold_samples;
+    uint64_t hold_ns_total;
+    uint64_t hold_start_ns;
+} AdaptiveMutex_t;
+
+void adaptive_init(AdaptiveMutex_t *m) {
+    atomic_init(&m->state, 0);
+    atomic_init(&m->contended, 0);
+    atomic_init(&m->spin_success, 0);
+    atomic_init(&m->parked, 0);
+    m->acquisitions = 0;
+    m->hold_samples = 0;
+    m->hold_ns_total = 0;
+    m->hold_start_ns = 0;
+}
+
+static void adaptive_on_acquired(AdaptiveMutex_t *m) {
+    m->acquisitions++;
+    m->hold_start_ns = (m->acquisitions % HOLD_SAMPLE_RATE == 0) ? now_ns() : 0;
+}
+
+void adaptive_lock(AdaptiveMutex_t *m) {
+    // 1. Fast path: uncontended, one CAS
+    int c = 0;
+    if (atomic_compare_exchange_strong_explicit(&m->state, &c, 1,
+                                                memory_order_acquire, memory_order_relaxed)) {
+        adaptive_on_acquired(m);
+        return;
+    }
+    atomic_fetch_add_explicit(&m->contended, 1, memory_order_relaxed);
+
+    // 2. Spin with exponential backoff: only READ while waiting (no cache-line ping-pong)
+    int backoff = 1;
+    for (int i = 0; i < SPIN_LIMIT; i++) {
+        for (int p = 0; p < backoff; p++) cpu_relax();
+        if (backoff < BACKOFF_MAX) backoff <<= 1;
+
+        c = atomic_load_explicit(&m->state, memory_order_relaxed);
+        if (c == 0 && atomic_compare_exchange_weak_explicit(&m->state, &c, 1,
+                                                            memory_order_acquire, memory_order_relaxed)) {
+            atomic_fetch_add_explicit(&m->spin_success, 1, memory_order_relaxed);
+            adaptive_on_acquired(m);
+            return;
+        }
+        if (c == 2) break; // Others are already asleep: don't bother spinning
+    }
+
+    // 3. Park: mark "waiters present" and sleep until woken
+    atomic_fetch_add_explicit(&m->parked, 1, memory_order_relaxed);
+    c = atomic_exchange_explicit(&m->state, 2, memory_order_acquire);
+    while (c != 0) {
+        futex_wait(&m->state, 2);
+        c = atomic_exchange_explicit(&m->state, 2, memory_order_acquire);
+    }
+    adaptive_on_acquired(m);
+}
+
+void adaptive_unlock(AdaptiveMutex_t *m) {
+    if (m->hold_start_ns != 0) {
+        m->hold_ns_total += now_ns() - m->hold_start_ns;
+        m->hold_samples++;
+    }
+    // 1 -> 0: nobody sleeping, no syscall. 2 -> 0: wake one sleeper.
+    if (atomic_fetch_sub_explicit(&m->state, 1, memory_order_release) != 1) {
+        atomic_store_explicit(&m->state, 0, memory_order_release);
+        futex_wake(&m->state, 1);
+    }
+}
+
+void print_adaptive_stats(AdaptiveMutex_t *m) {
+    uint64_t contended = atomic_load(&m->contended);
+    uint64_t spin_ok = atomic_load(&m->spin_success);
+    printf("    [Adaptive stats] acquisitions %llu, contended %.2f%%, spin success %.1f%%, "
+           "parked %llu, avg hold %.1f ns\n",
+           (unsigned long long)m->acquisitions,
+           m->acquisitions ? 100.0 * contended / m->acquisitions : 0.0,
+           contended ? 100.0 * spin_ok / contended : 0.0,
+           (unsigned long long)atomic_load(&m->parked),
+           m->hold_samples ? (double)m->hold_ns_total / m->hold_samples : 0.0);
+}
+
+// --- Plain test-and-set spinlock (the baseline that never sleeps) ---
+
+typedef struct {
+    atomic_flag flag;
+} SpinLock_t;
+
+void spin_lock(SpinLock_t *l) {
+    while (atomic_flag_test_and_set_explicit(&l->flag, memory_order_acquire)) {
+        cpu_relax();
+    }
+}
+
+void spin_unlock(SpinLock_t *l) {
+    atomic_flag_clear_explicit(&l->flag, memory_order_release);
+}
+
+// --- Shared counter workload ---
+
+typedef enum { LOCK_PTHREAD, LOCK_SPIN, LOCK_ADAPTIVE } LockKind_t;
+static const char *lock_names[] = { "pthread_mutex", "test-and-set", "adaptive" };
+
+static pthread_mutex_t pthread_lock = PTHREAD_MUTEX_INITIALIZER;
+static SpinLock_t tas_lock = { ATOMIC_FLAG_INIT };
+static AdaptiveMutex_t adaptive_lock_obj;
+
+static uint64_t shared_counter = 0;
+static long increments_per_thread = 1000000;
+
+static void *worker(void *arg) {
+    LockKind_t kind = (LockKind_t)(intptr_t)arg;
+    for (long i = 0; i < increments_per_thread; i++) {
+        switch (kind) {
+        case LOCK_PTHREAD:
+            pthread_mutex_lock(&pthread_lock);
+            shared_counter++;
+            pthread_mutex_unlock(&pthread_lock);
+            break;
+        case LOCK_SPIN:
+            spin_lock(&tas_lock);
+            shared_counter++;
+            spin_unlock(&tas_lock);
+            break;
+        case LOCK_ADAPTIVE:
+            adaptive_lock(&adaptive_lock_obj);
+            shared_counter++;
+            adaptive_unlock(&adaptive_lock_obj);
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void run(LockKind_t kind, int threads) {
+    pthread_t tid[threads];
+    shared_counter = 0;
+    adaptive_init(&adaptive_lock_obj);
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < threads; i++) pthread_create(&tid[i], NULL, worker, (void *)(intptr_t)kind);
+    for (int i = 0; i < threads; i++) pthread_join(tid[i], NULL);
+    uint64_t elapsed = now_ns() - start;
+
+    uint64_t expected = (uint64_t)threads * (uint64_t)increments_per_thread;
+    printf("  %-14s %3d threads: %8.2f M increments/s  %s\n", lock_names[kind], threads,
+           (double)expected * 1e3 / (double)elapsed,
+           (shared_counter == expected) ? "(counter OK)" : "(LOST UPDATES!)");
+    if (kind == LOCK_ADAPTIVE) print_adaptive_stats(&adaptive_lock_obj);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) increments_per_thread = atol(argv[1]);
+    if (increments_per_thread <= 0) {
+        printf("Usage: %s [increments_per_thread>0]\n", argv[0]);
+        return 1;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("=== Shared Counter: pthread_mutex vs Test-and-Set vs Adaptive (%ld cores) ===\n", cores);
+
+    int thread_counts[] = { 1, 2, 4, 8 };
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        printf("\n");
+        for (int k = LOCK_PTHREAD; k <= LOCK_ADAPTIVE; k++) run((LockKind_t)k, thread_counts[t]);
+    }
+
+    return 0;
+}
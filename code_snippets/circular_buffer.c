@@ -1,64 +1,194 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdatomic.h>
 
 /*
  * Circular Buffer (Ring Buffer)
- * 
+ *
  * WHY: Used heavily in UART/Audio drivers.
  * - Producer (ISR) writes data.
  * - Consumer (Task) reads data.
  * - "Circular" means when we reach the end, we wrap around to index 0.
  * - No need to shift elements (O(1) complexity).
+ *
+ * Lock-Free SPSC (Single Producer / Single Consumer) design:
+ * - A shared 'count' would be modified by BOTH sides -> needs a lock.
+ * - Instead: head is written ONLY by the producer, tail ONLY by the consumer.
+ * - head/tail are "free running" (never wrapped). Used = head - tail.
+ *   Unsigned subtraction stays correct even when the counters overflow.
+ * - Size is a power of 2, so "index % SIZE" becomes "index & MASK" (no divide).
+ * - Release store on publish / Acquire load on observe:
+ *   the data bytes are visible BEFORE the index that announces them.
+ *
+ * Zero-Copy API (Reserve/Commit, Peek/Consume):
+ * - rb_write/rb_read copy every byte twice (driver -> buffer -> reader).
+ * - rb_reserve hands the Producer a pointer INTO the buffer (e.g., DMA target).
+ *   rb_commit publishes the bytes once they are filled in.
+ * - rb_peek hands the Consumer a pointer to the stored bytes (e.g., a parser).
+ *   rb_consume frees them once processed.
+ * - Spans are always contiguous, so near the wrap you get a shorter span;
+ *   call again after commit/consume to get the part at index 0.
  */
 
-#define BUFFER_SIZE 5
+#define BUFFER_SIZE 8 // MUST be a power of 2
+#define BUFFER_MASK (BUFFER_SIZE - 1)
+
+_Static_assert((BUFFER_SIZE & BUFFER_MASK) == 0, "BUFFER_SIZE must be a power of 2");
 
 typedef struct {
     uint8_t buffer[BUFFER_SIZE];
-    int head; // Write Index
-    int tail; // Read Index
-    int count;
+    _Atomic uint32_t head; // Write Index (free running, owned by Producer)
+    _Atomic uint32_t tail; // Read Index  (free running, owned by Consumer)
 } RingBuffer_t;
 
+// A contiguous window into the buffer's own storage
+typedef struct {
+    uint8_t *data;
+    size_t len;
+} RingSpan_t;
+
 void rb_init(RingBuffer_t *rb) {
-    rb->head = 0;
-    rb->tail = 0;
-    rb->count = 0;
+    atomic_init(&rb->head, 0);
+    atomic_init(&rb->tail, 0);
 }
 
+// Bytes currently stored. Safe to call from either side (snapshot only).
+uint32_t rb_count(RingBuffer_t *rb) {
+    uint32_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    return head - tail;
+}
+
+// --- Producer side (ISR) ---
+
 bool rb_write(RingBuffer_t *rb, uint8_t data) {
-    if (rb->count == BUFFER_SIZE) {
+    uint32_t head = atomic_load_explicit(&rb->head, memory_order_relaxed); // We own it
+    uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+
+    if (head - tail == BUFFER_SIZE) {
         printf("[Overflow] Buffer Full! Dropping %d\n", data);
         return false;
     }
-    
-    rb->buffer[rb->head] = data;
-    // Wrap around logic: (0 -> 1 -> 2 -> 3 -> 4 -> 0)
-    rb->head = (rb->head + 1) % BUFFER_SIZE;
-    rb->count++;
+
+    rb->buffer[head & BUFFER_MASK] = data;
+    // Publish: the byte above is visible before the new head
+    atomic_store_explicit(&rb->head, head + 1, memory_order_release);
     return true;
 }
 
+// Copy up to 'len' bytes in. Returns how many were written (may be < len if full).
+// At most TWO memcpy calls: [head .. end of array] and [0 .. rest].
+size_t rb_write_bulk(RingBuffer_t *rb, const uint8_t *src, size_t len) {
+    uint32_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+
+    size_t space = BUFFER_SIZE - (head - tail);
+    if (len > space) len = space;
+    if (len == 0) return 0;
+
+    size_t offset = head & BUFFER_MASK;
+    size_t first = BUFFER_SIZE - offset; // Contiguous room before the wrap
+    if (first > len) first = len;
+
+    memcpy(&rb->buffer[offset], src, first);
+    memcpy(&rb->buffer[0], src + first, len - first); // Wrapped part (may be 0)
+
+    atomic_store_explicit(&rb->head, head + (uint32_t)len, memory_order_release);
+    return len;
+}
+
+// Get a contiguous writable window of up to 'len' bytes. Returns the granted length.
+// Nothing is visible to the Consumer until rb_commit().
+size_t rb_reserve(RingBuffer_t *rb, size_t len, RingSpan_t *span) {
+    uint32_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+
+    size_t space = BUFFER_SIZE - (head - tail);
+    size_t offset = head & BUFFER_MASK;
+    size_t contiguous = BUFFER_SIZE - offset;
+    if (space > contiguous) space = contiguous; // Stop at the wrap
+    if (len > space) len = space;
+
+    span->data = &rb->buffer[offset];
+    span->len = len;
+    return len;
+}
+
+// Publish 'len' bytes previously filled via rb_reserve()
+void rb_commit(RingBuffer_t *rb, size_t len) {
+    uint32_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    atomic_store_explicit(&rb->head, head + (uint32_t)len, memory_order_release);
+}
+
+// --- Consumer side (Task) ---
+
 bool rb_read(RingBuffer_t *rb, uint8_t *data) {
-    if (rb->count == 0) {
+    uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed); // We own it
+    uint32_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+
+    if (head == tail) {
         printf("[Underflow] Buffer Empty!\n");
         return false;
     }
-    
-    *data = rb->buffer[rb->tail];
-    // Wrap around logic
-    rb->tail = (rb->tail + 1) % BUFFER_SIZE;
-    rb->count--;
+
+    *data = rb->buffer[tail & BUFFER_MASK];
+    // Release the slot back to the Producer
+    atomic_store_explicit(&rb->tail, tail + 1, memory_order_release);
     return true;
 }
 
+// Copy up to 'len' bytes out. Returns how many were read (may be < len if empty).
+size_t rb_read_bulk(RingBuffer_t *rb, uint8_t *dst, size_t len) {
+    uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+
+    size_t used = head - tail;
+    if (len > used) len = used;
+    if (len == 0) return 0;
+
+    size_t offset = tail & BUFFER_MASK;
+    size_t first = BUFFER_SIZE - offset;
+    if (first > len) first = len;
+
+    memcpy(dst, &rb->buffer[offset], first);
+    memcpy(dst + first, &rb->buffer[0], len - first);
+
+    atomic_store_explicit(&rb->tail, tail + (uint32_t)len, memory_order_release);
+    return len;
+}
+
+// Get a contiguous readable window of the stored bytes. Returns its length.
+size_t rb_peek(RingBuffer_t *rb, RingSpan_t *span) {
+    uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+
+    size_t used = head - tail;
+    size_t offset = tail & BUFFER_MASK;
+    size_t contiguous = BUFFER_SIZE - offset;
+    if (used > contiguous) used = contiguous; // Stop at the wrap
+
+    span->data = &rb->buffer[offset];
+    span->len = used;
+    return used;
+}
+
+// Release 'len' bytes previously obtained via rb_peek()
+void rb_consume(RingBuffer_t *rb, size_t len) {
+    uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    atomic_store_explicit(&rb->tail, tail + (uint32_t)len, memory_order_release);
+}
+
 void print_buffer(RingBuffer_t *rb) {
-    printf("Buffer [Count %d]: ", rb->count);
+    uint32_t head = atomic_load(&rb->head) & BUFFER_MASK;
+    uint32_t tail = atomic_load(&rb->tail) & BUFFER_MASK;
+    printf("Buffer [Count %u]: ", rb_count(rb));
     // Note: This print is just for debug, it doesn't respect the "Ring" visual perfectly
-    for(int i=0; i<BUFFER_SIZE; i++) {
-        if (i == rb->head) printf("H");
-        if (i == rb->tail) printf("T");
+    for(uint32_t i=0; i<BUFFER_SIZE; i++) {
+        if (i == head) printf("H");
+        if (i == tail) printf("T");
         printf("[%d] ", rb->buffer[i]);
     }
     printf("\n");
@@ -66,6 +196,7 @@ void print_buffer(RingBuffer_t *rb) {
 
 int main() {
     RingBuffer_t rb;
+    memset(rb.buffer, 0, sizeof(rb.buffer));
     rb_init(&rb);
     uint8_t val;
 
@@ -80,14 +211,44 @@ int main() {
     rb_read(&rb, &val); printf("Read: %d\n", val);
     print_buffer(&rb);
 
-    printf("3. Writing 3 more (40, 50, 60) - WRAP AROUND!\n");
-    rb_write(&rb, 40);
-    rb_write(&rb, 50);
-    rb_write(&rb, 60); // This should wrap to index 0
+    printf("3. Bulk writing 6 more (40..90) - WRAP AROUND!\n");
+    uint8_t chunk[] = {40, 50, 60, 70, 80, 90};
+    size_t n = rb_write_bulk(&rb, chunk, sizeof(chunk)); // Two memcpy segments
+    printf("Wrote %zu bytes\n", n);
+    print_buffer(&rb);
+
+    printf("4. Writing two more (100, 110) - OVERFLOW!\n");
+    rb_write(&rb, 100);
+    rb_write(&rb, 110);
+
+    printf("5. Bulk reading everything...\n");
+    uint8_t out[BUFFER_SIZE];
+    n = rb_read_bulk(&rb, out, sizeof(out));
+    printf("Read %zu bytes: ", n);
+    for (size_t i = 0; i < n; i++) printf("%d ", out[i]);
+    printf("\n");
     print_buffer(&rb);
 
-    printf("4. Writing one more (70) - OVERFLOW!\n");
-    rb_write(&rb, 70);
+    printf("6. Zero-Copy: 'DMA' fills 8 bytes directly in the buffer...\n");
+    RingSpan_t span;
+    uint8_t dma_val = 1;
+    size_t wanted = 8; // Crosses the wrap -> two reservations
+    while (wanted > 0 && rb_reserve(&rb, wanted, &span) > 0) {
+        printf("Reserved %zu contiguous bytes at index %td\n", span.len, span.data - rb.buffer);
+        for (size_t i = 0; i < span.len; i++) span.data[i] = dma_val++; // Hardware writes here
+        rb_commit(&rb, span.len);
+        wanted -= span.len;
+    }
+    print_buffer(&rb);
+
+    printf("7. Zero-Copy: Parser reads in place...\n");
+    while (rb_peek(&rb, &span) > 0) {
+        printf("Peeked %zu bytes: ", span.len);
+        for (size_t i = 0; i < span.len; i++) printf("%d ", span.data[i]);
+        printf("\n");
+        rb_consume(&rb, span.len);
+    }
+    print_buffer(&rb);
 
     return 0;
 }
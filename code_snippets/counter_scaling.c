@@ -0,0 +1,154 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Shared Counter Scaling: Unsafe vs Mutex vs Atomic vs Sharded
+ *
+ * race_condition_mutex.c fixes the lost update with a mutex. For a counter
+ * that EVERY core bumps millions of times per second (telemetry, statistics)
+ * the lock itself becomes the bottleneck. The options:
+ * 1. Unsafe:  counter++            -> fast, but loses updates.
+ * 2. Mutex:   lock; counter++; unlock -> correct, threads queue up on the lock.
+ * 3. Atomic:  atomic_fetch_add()   -> correct, one instruction (LOCK XADD / LDADD),
+ *    but all cores still fight over ONE cache line.
+ * 4. Sharded: each thread has its OWN counter on its OWN cache line,
+ *    and a reader sums them. Writes never conflict -> scales with cores.
+ *    Cost: reads are O(threads) and only a snapshot. Fine for statistics.
+ *
+ * Why the padding? Two counters in the same 64-byte cache line still
+ * ping-pong between cores ("false sharing") even though they're different variables.
+ *
+ * Build: gcc -O2 -pthread counter_scaling.c -o counter_scaling
+ * Run:   ./counter_scaling [increments_per_thread]
+ */
+
+#define MAX_THREADS     64
+#define CACHE_LINE_SIZE 64
+
+typedef enum { MODE_UNSAFE, MODE_MUTEX, MODE_ATOMIC, MODE_SHARDED } CounterMode_t;
+static const char *mode_names[] = { "unsafe", "mutex", "atomic", "sharded" };
+
+// 1 + 2: the plain shared counter
+static volatile uint64_t shared_counter = 0;
+static pthread_mutex_t counter_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// 3: one atomic counter
+static atomic_uint_fast64_t atomic_counter;
+
+// 4: one padded slot per thread
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint_fast64_t value;
+} CounterShard_t;
+
+static CounterShard_t shards[MAX_THREADS];
+
+// Sharded increment: only this thread writes its slot, so a plain load + store
+// is enough (no LOCK prefix). Atomic only so the reader never sees a torn value.
+static inline void sharded_increment(int shard) {
+    atomic_uint_fast64_t *v = &shards[shard].value;
+    atomic_store_explicit(v, atomic_load_explicit(v, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+// Sum on read (a snapshot: other threads may still be counting)
+static uint64_t sharded_read() {
+    uint64_t sum = 0;
+    for (int i = 0; i < MAX_THREADS; i++) {
+        sum += atomic_load_explicit(&shards[i].value, memory_order_relaxed);
+    }
+    return sum;
+}
+
+typedef struct {
+    CounterMode_t mode;
+    int index;
+    long increments;
+} Worker_t;
+
+static void *worker(void *arg) {
+    Worker_t *w = arg;
+    switch (w->mode) {
+    case MODE_UNSAFE:
+        for (long i = 0; i < w->increments; i++) shared_counter++; // Read-Modify-Write race
+        break;
+    case MODE_MUTEX:
+        for (long i = 0; i < w->increments; i++) {
+            pthread_mutex_lock(&counter_mutex);
+            shared_counter++;
+            pthread_mutex_unlock(&counter_mutex);
+        }
+        break;
+    case MODE_ATOMIC:
+        for (long i = 0; i < w->increments; i++) {
+            atomic_fetch_add_explicit(&atomic_counter, 1, memory_order_relaxed);
+        }
+        break;
+    case MODE_SHARDED:
+        for (long i = 0; i < w->increments; i++) sharded_increment(w->index);
+        break;
+    }
+    return NULL;
+}
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static double run(CounterMode_t mode, int threads, long increments, uint64_t *result) {
+    pthread_t tid[MAX_THREADS];
+    Worker_t workers[MAX_THREADS];
+
+    shared_counter = 0;
+    atomic_store(&atomic_counter, 0);
+    for (int i = 0; i < MAX_THREADS; i++) atomic_store(&shards[i].value, 0);
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < threads; i++) {
+        workers[i] = (Worker_t){ .mode = mode, .index = i, .increments = increments };
+        pthread_create(&tid[i], NULL, worker, &workers[i]);
+    }
+    for (int i = 0; i < threads; i++) pthread_join(tid[i], NULL);
+    uint64_t elapsed = now_ns() - start;
+
+    switch (mode) {
+    case MODE_UNSAFE:
+    case MODE_MUTEX:   *result = shared_counter; break;
+    case MODE_ATOMIC:  *result = atomic_load(&atomic_counter); break;
+    case MODE_SHARDED: *result = sharded_read(); break;
+    }
+    return (double)threads * (double)increments * 1e3 / (double)elapsed; // M ops/sec
+}
+
+int main(int argc, char **argv) {
+    long increments = (argc > 1) ? atol(argv[1]) : 200000;
+    if (increments <= 0) {
+        printf("Usage: %s [increments_per_thread>0]\n", argv[0]);
+        return 1;
+    }
+
+    printf("=== Shared Counter Scaling (%ld cores, %ld increments per thread) ===\n",
+           sysconf(_SC_NPROCESSORS_ONLN), increments);
+    printf("(M increments/sec; '!' = lost updates)\n\n");
+    printf("%8s", "Threads");
+    for (int m = MODE_UNSAFE; m <= MODE_SHARDED; m++) printf(" %12s", mode_names[m]);
+    printf("\n");
+
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        printf("%8d", threads);
+        for (int m = MODE_UNSAFE; m <= MODE_SHARDED; m++) {
+            uint64_t result;
+            double mops = run((CounterMode_t)m, threads, increments, &result);
+            printf(" %11.1f%c", mops, (result == (uint64_t)threads * (uint64_t)increments) ? ' ' : '!');
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
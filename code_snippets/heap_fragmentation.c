@@ -1,134 +1,544 @@
 #include <stdio.h>
+#include <assert.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 
 /*
- * Phase 5: Heap Management Simulation
- * 
+ * Phase 5: Heap Management Simulation (heap_4 style)
+ *
  * Demonstrates:
  * 1. Fragmentation (The "Swiss Cheese" problem).
  * 2. Why Coalescence (Merging free blocks) is critical.
- * 
+ *
+ * How the allocator works (same idea as FreeRTOS heap_4.c):
+ * - Every block starts with a small HEADER: { next free block, block size }.
+ * - Free blocks are kept in a singly linked list sorted by ADDRESS.
+ * - Alloc walks the free list (First Fit or Best Fit), splits the block
+ *   if the leftover is big enough to be useful, and returns ptr + header.
+ * - Free reads the size back from the header (caller doesn't pass it!)
+ *   and re-inserts the block. Because the list is address-ordered, the
+ *   neighbours are right there -> merge with them immediately (Coalescence).
+ * - Searching the list is O(free blocks). For hard real-time there is a
+ *   TLSF backend with O(1) alloc/free (see below), same API and stats.
+ *
  * Scenario:
- * - We have a 100 byte heap.
- * - We allocate 3 blocks of 20 bytes.
- * - We free the middle one.
- * - We try to allocate 40 bytes.
+ * - We have a 256 byte heap.
+ * - We allocate 3 blocks, free the middle one, and try a bigger allocation.
+ * - Then we create holes separated by "barrier" blocks and watch it fail.
  */
 
-#define HEAP_SIZE 100
+#define HEAP_SIZE 256
+#define HEAP_ALIGNMENT 8
+#define HEAP_ALIGN_MASK (HEAP_ALIGNMENT - 1)
 
+// Backend: the classic free list, or TLSF for O(1) hard-real-time allocation.
+// Build with -DHEAP_BACKEND=HEAP_BACKEND_TLSF to switch.
+#define HEAP_BACKEND_FREE_LIST 0
+#define HEAP_BACKEND_TLSF      1
+#ifndef HEAP_BACKEND
+#define HEAP_BACKEND HEAP_BACKEND_FREE_LIST
+#endif
+
+// Fit policy (free list backend): First Fit is faster, Best Fit leaves fewer tiny holes.
+#define HEAP_FIRST_FIT 0
+#define HEAP_BEST_FIT  1
+#ifndef HEAP_FIT_POLICY
+#define HEAP_FIT_POLICY HEAP_FIRST_FIT
+#endif
+
+// Same fields as FreeRTOS HeapStats_t
 typedef struct {
-    uint8_t memory[HEAP_SIZE];
-    bool is_allocated[HEAP_SIZE]; // Map of used bytes (Simplified)
-} SimpleHeap_t;
+    size_t available_bytes;        // Total free bytes right now
+    size_t largest_free_block;     // Biggest single allocation that can succeed
+    size_t smallest_free_block;
+    size_t free_block_count;       // Many small blocks = fragmented
+    size_t min_ever_free_bytes;    // Low-water mark: closest we came to running out
+    size_t successful_allocations;
+    size_t successful_frees;
+} HeapStats_t;
+
+static _Alignas(HEAP_ALIGNMENT) uint8_t heap_memory[HEAP_SIZE];
+static HeapStats_t heap_stats;
+
+#if HEAP_BACKEND == HEAP_BACKEND_TLSF
+/*
+ * TLSF backend (Two-Level Segregated Fit)
+ *
+ * - Free blocks are binned by size into lists[fl][sl]:
+ *   fl (First Level)  = power of 2 of the size (fls = find last set)
+ *   sl (Second Level) = which of SL_COUNT equal slices inside that power of 2
+ * - fl_bitmap says which fl rows have ANY free block, sl_bitmap[fl] says
+ *   which lists in that row are non-empty.
+ * - Alloc: round the size UP to the next bin, then two find-first-set ops
+ *   on the bitmaps give a non-empty list whose blocks are ALL big enough.
+ *   No list walking -> O(1), same cost for an empty or fragmented heap.
+ * - Free: each header also points to its physical PREVIOUS block, so both
+ *   neighbours are found without searching -> O(1) coalescing.
+ */
+
+#define TLSF_SL_LOG2        4                                 // 16 second-level lists
+#define TLSF_SL_COUNT       (1 << TLSF_SL_LOG2)
+#define TLSF_ALIGN_LOG2     3                                 // 8 byte alignment
+#define TLSF_FL_SHIFT       (TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_SMALL_BLOCK    (1 << TLSF_FL_SHIFT)              // Below this: linear bins
+#define TLSF_FL_MAX         20                                // Heaps up to 1 MB
+#define TLSF_FL_COUNT       (TLSF_FL_MAX - TLSF_FL_SHIFT + 1)
+
+#define TLSF_BLOCK_FREE     ((size_t)1)                       // Low bit of size (sizes are 8-aligned)
+#define TLSF_SIZE_MASK      (~(size_t)HEAP_ALIGN_MASK)
+
+_Static_assert(HEAP_ALIGNMENT == (1 << TLSF_ALIGN_LOG2), "TLSF alignment mismatch");
+// Every free block must be < 2^TLSF_FL_MAX to have a row in free_lists[]
+_Static_assert(HEAP_SIZE <= ((size_t)1 << TLSF_FL_MAX), "Raise TLSF_FL_MAX for this heap");
+
+typedef struct TlsfBlock {
+    struct TlsfBlock *prev_phys; // Block physically before this one
+    size_t size;                 // Block size INCLUDING header, low bit = free
+    // Only valid while the block is FREE (overlaps the user's data otherwise)
+    struct TlsfBlock *next_free;
+    struct TlsfBlock *prev_free;
+} TlsfBlock_t;
+
+#define HEADER_SIZE         offsetof(TlsfBlock_t, next_free)
+#define TLSF_MIN_BLOCK      sizeof(TlsfBlock_t)
+
+static uint32_t fl_bitmap;
+static uint32_t sl_bitmap[TLSF_FL_COUNT];
+static TlsfBlock_t *free_lists[TLSF_FL_COUNT][TLSF_SL_COUNT];
+static TlsfBlock_t *heap_end; // Zero-size "allocated" block: stops coalescing at the top
+
+static inline int tlsf_fls(size_t x) { return (int)(sizeof(unsigned long) * 8) - 1 - __builtin_clzl(x); }
+static inline int tlsf_ffs(uint32_t x) { return __builtin_ctz(x); }
+
+static inline size_t block_size(const TlsfBlock_t *b) { return b->size & TLSF_SIZE_MASK; }
+static inline bool block_is_free(const TlsfBlock_t *b) { return (b->size & TLSF_BLOCK_FREE) != 0; }
+static inline TlsfBlock_t *block_next_phys(TlsfBlock_t *b) {
+    return (TlsfBlock_t *)((uint8_t *)b + block_size(b));
+}
+
+// Size -> (fl, sl). fl may be past the table for sizes the heap can't hold.
+static void mapping(size_t size, int *fl, int *sl) {
+    if (size < TLSF_SMALL_BLOCK) {
+        *fl = 0;
+        *sl = (int)(size / (TLSF_SMALL_BLOCK / TLSF_SL_COUNT));
+    } else {
+        int f = tlsf_fls(size);
+        *sl = (int)(size >> (f - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT; // Drop the leading 1
+        *fl = f - (TLSF_FL_SHIFT - 1);
+    }
+}
+
+// Which list does a block of this size belong to?
+static void mapping_insert(size_t size, int *fl, int *sl) {
+    mapping(size, fl, sl);
+    assert(*fl < TLSF_FL_COUNT); // A real free block always has a row
+}
+
+// Which list is guaranteed to hold blocks >= size? (Round up to the next bin)
+static void mapping_search(size_t size, int *fl, int *sl) {
+    if (size >= TLSF_SMALL_BLOCK) {
+        size += ((size_t)1 << (tlsf_fls(size) - TLSF_SL_LOG2)) - 1;
+    }
+    mapping(size, fl, sl); // Caller checks fl: a too-big request just fails
+}
+
+static void insert_free_block(TlsfBlock_t *block) {
+    int fl, sl;
+    mapping_insert(block_size(block), &fl, &sl);
+
+    TlsfBlock_t *head = free_lists[fl][sl];
+    block->prev_free = NULL;
+    block->next_free = head;
+    if (head != NULL) head->prev_free = block;
+    free_lists[fl][sl] = block;
+
+    fl_bitmap |= 1U << fl;
+    sl_bitmap[fl] |= 1U << sl;
+}
+
+static void remove_free_block(TlsfBlock_t *block) {
+    int fl, sl;
+    mapping_insert(block_size(block), &fl, &sl);
+
+    if (block->prev_free != NULL) block->prev_free->next_free = block->next_free;
+    else free_lists[fl][sl] = block->next_free;
+    if (block->next_free != NULL) block->next_free->prev_free = block->prev_free;
+
+    if (free_lists[fl][sl] == NULL) {
+        sl_bitmap[fl] &= ~(1U << sl);
+        if (sl_bitmap[fl] == 0) fl_bitmap &= ~(1U << fl);
+    }
+}
+
+// Two find-first-set operations, no loops
+static TlsfBlock_t *find_suitable_block(int fl, int sl) {
+    uint32_t sl_map = sl_bitmap[fl] & (~0U << sl);
+    if (sl_map == 0) {
+        // Nothing left in this row: jump to the next non-empty (bigger) row
+        uint32_t fl_map = (fl + 1 < 32) ? fl_bitmap & (~0U << (fl + 1)) : 0;
+        if (fl_map == 0) return NULL; // Out of memory
+        fl = tlsf_ffs(fl_map);
+        sl_map = sl_bitmap[fl];
+    }
+    return free_lists[fl][tlsf_ffs(sl_map)];
+}
+
+void heap_init() {
+    memset(heap_memory, 0, HEAP_SIZE);
+    memset(free_lists, 0, sizeof(free_lists));
+    memset(sl_bitmap, 0, sizeof(sl_bitmap));
+    fl_bitmap = 0;
+
+    // Initially: one big free block, followed by the end marker
+    // (the marker gets a whole TlsfBlock_t so it is a complete object)
+    size_t end_offset = (HEAP_SIZE - TLSF_MIN_BLOCK) & TLSF_SIZE_MASK;
+    TlsfBlock_t *first = (TlsfBlock_t *)heap_memory;
+    first->prev_phys = NULL;
+    first->size = end_offset | TLSF_BLOCK_FREE;
+
+    heap_end = (TlsfBlock_t *)&heap_memory[end_offset];
+    heap_end->prev_phys = first;
+    heap_end->size = 0; // Never free -> never merged
+
+    insert_free_block(first);
+
+    memset(&heap_stats, 0, sizeof(heap_stats));
+    heap_stats.available_bytes = end_offset;
+    heap_stats.min_ever_free_bytes = end_offset;
+}
+
+void *heap_alloc(size_t size) {
+    if (size == 0 || size > HEAP_SIZE) {
+        printf("[Heap] FAILED to allocate %zu bytes! (Invalid size)\n", size);
+        return NULL;
+    }
+
+    size_t wanted = (size + HEADER_SIZE + HEAP_ALIGN_MASK) & TLSF_SIZE_MASK;
+    if (wanted < TLSF_MIN_BLOCK) wanted = TLSF_MIN_BLOCK;
+
+    int fl, sl;
+    mapping_search(wanted, &fl, &sl);
+    TlsfBlock_t *block = (fl < TLSF_FL_COUNT) ? find_suitable_block(fl, sl) : NULL;
+    if (block == NULL) {
+        printf("[Heap] FAILED to allocate %zu bytes! (Fragmentation?)\n", size);
+        return NULL;
+    }
+    remove_free_block(block);
+
+    // Split: give back the tail if it is big enough to be a block on its own
+    size_t total = block_size(block);
+    if (total - wanted >= TLSF_MIN_BLOCK) {
+        TlsfBlock_t *remainder = (TlsfBlock_t *)((uint8_t *)block + wanted);
+        remainder->prev_phys = block;
+        remainder->size = (total - wanted) | TLSF_BLOCK_FREE;
+        block_next_phys(remainder)->prev_phys = remainder;
+        insert_free_block(remainder);
+        total = wanted;
+    }
+    block->size = total; // Clears the FREE bit
+
+    heap_stats.available_bytes -= total;
+    if (heap_stats.available_bytes < heap_stats.min_ever_free_bytes) {
+        heap_stats.min_ever_free_bytes = heap_stats.available_bytes;
+    }
+    heap_stats.successful_allocations++;
+
+    void *user_ptr = (uint8_t *)block + HEADER_SIZE;
+    printf("[Heap] Allocated %zu bytes at Index %td (block %zu bytes)\n",
+           size, (uint8_t *)user_ptr - heap_memory, total);
+    return user_ptr;
+}
+
+void heap_free(void *ptr) {
+    if (ptr == NULL) return;
+
+    TlsfBlock_t *block = (TlsfBlock_t *)((uint8_t *)ptr - HEADER_SIZE);
+    if (block_is_free(block)) {
+        printf("[Heap] ERROR: Index %td is not an allocated block (double free?)\n",
+               (uint8_t *)ptr - heap_memory);
+        return;
+    }
+
+    heap_stats.available_bytes += block_size(block);
+    heap_stats.successful_frees++;
+    printf("[Heap] Freed %zu bytes at Index %td\n", block_size(block) - HEADER_SIZE, (uint8_t *)ptr - heap_memory);
+
+    block->size |= TLSF_BLOCK_FREE;
 
-SimpleHeap_t my_heap;
+    // Merge with the physical previous block (found via the header, no search)
+    TlsfBlock_t *prev = block->prev_phys;
+    if (prev != NULL && block_is_free(prev)) {
+        remove_free_block(prev);
+        prev->size += block_size(block);
+        block = prev;
+    }
+
+    // Merge with the physical next block
+    TlsfBlock_t *next = block_next_phys(block);
+    if (block_is_free(next)) {
+        remove_free_block(next);
+        block->size += block_size(next);
+    }
+
+    block_next_phys(block)->prev_phys = block;
+    insert_free_block(block);
+}
+
+void heap_get_stats(HeapStats_t *stats) {
+    *stats = heap_stats;
+    stats->largest_free_block = 0;
+    stats->smallest_free_block = 0;
+    stats->free_block_count = 0;
+
+    // Diagnostics only: walk the physical blocks
+    for (TlsfBlock_t *b = (TlsfBlock_t *)heap_memory; b != heap_end; b = block_next_phys(b)) {
+        if (!block_is_free(b)) continue;
+        size_t sz = block_size(b);
+        if (sz > stats->largest_free_block) stats->largest_free_block = sz;
+        if (stats->smallest_free_block == 0 || sz < stats->smallest_free_block) {
+            stats->smallest_free_block = sz;
+        }
+        stats->free_block_count++;
+    }
+}
+
+#else // HEAP_BACKEND_FREE_LIST
+
+// The Block Header (sits right before the pointer handed to the user)
+typedef struct BlockLink {
+    struct BlockLink *next_free; // Next free block (by address). NULL while allocated.
+    size_t size;                 // Block size INCLUDING header. Top bit = allocated.
+} BlockLink_t;
+
+#define HEADER_SIZE    ((sizeof(BlockLink_t) + HEAP_ALIGN_MASK) & ~(size_t)HEAP_ALIGN_MASK)
+#define MIN_BLOCK_SIZE (HEADER_SIZE * 2) // Don't split off blocks smaller than this
+#define ALLOCATED_BIT  ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
+static BlockLink_t heap_start;   // Dummy head of the free list (size 0)
+static BlockLink_t *heap_end;    // End marker at the top of the heap
+
+// Put a block back into the address-ordered free list, merging with neighbours
+static void insert_block_into_free_list(BlockLink_t *block) {
+    BlockLink_t *iterator = &heap_start;
+
+    // Find the free block just BEFORE this one (by address)
+    while (iterator->next_free < block) {
+        iterator = iterator->next_free;
+    }
+
+    // Does the previous free block end exactly where this one starts? Merge down.
+    if ((uint8_t *)iterator + iterator->size == (uint8_t *)block) {
+        iterator->size += block->size;
+        block = iterator;
+    }
+
+    // Does this block end exactly where the next free block starts? Merge up.
+    BlockLink_t *next = iterator->next_free;
+    if ((uint8_t *)block + block->size == (uint8_t *)next && next != heap_end) {
+        block->size += next->size;
+        block->next_free = next->next_free;
+    } else {
+        block->next_free = next;
+    }
+
+    // If we merged down, 'iterator' already IS the block
+    if (iterator != block) {
+        iterator->next_free = block;
+    }
+}
 
 void heap_init() {
-    memset(my_heap.is_allocated, 0, HEAP_SIZE);
-}
-
-// A dumb allocator (First Fit) - No Coalescence logic needed for this sim
-// because we track byte-by-byte.
-int heap_alloc(int size) {
-    int consecutive_free = 0;
-    int start_index = -1;
-
-    for (int i = 0; i < HEAP_SIZE; i++) {
-        if (!my_heap.is_allocated[i]) {
-            if (consecutive_free == 0) start_index = i;
-            consecutive_free++;
-            if (consecutive_free == size) {
-                // Found a block! Mark it used.
-                for (int j = start_index; j < start_index + size; j++) {
-                    my_heap.is_allocated[j] = true;
-                }
-                printf("[Heap] Allocated %d bytes at Index %d\n", size, start_index);
-                return start_index;
-            }
-        } else {
-            consecutive_free = 0;
-            start_index = -1;
+    memset(heap_memory, 0, HEAP_SIZE);
+
+    // End marker lives at the (aligned) top of the heap
+    size_t end_offset = (HEAP_SIZE - HEADER_SIZE) & ~(size_t)HEAP_ALIGN_MASK;
+    heap_end = (BlockLink_t *)&heap_memory[end_offset];
+    heap_end->size = 0;
+    heap_end->next_free = NULL;
+
+    // Initially: one big free block spanning the whole heap
+    BlockLink_t *first = (BlockLink_t *)heap_memory;
+    first->size = end_offset;
+    first->next_free = heap_end;
+
+    heap_start.size = 0;
+    heap_start.next_free = first;
+
+    memset(&heap_stats, 0, sizeof(heap_stats));
+    heap_stats.available_bytes = first->size;
+    heap_stats.min_ever_free_bytes = first->size;
+}
+
+void *heap_alloc(size_t size) {
+    if (size == 0 || size > HEAP_SIZE) {
+        printf("[Heap] FAILED to allocate %zu bytes! (Invalid size)\n", size);
+        return NULL;
+    }
+
+    size_t wanted = (size + HEADER_SIZE + HEAP_ALIGN_MASK) & ~(size_t)HEAP_ALIGN_MASK;
+
+    BlockLink_t *prev = &heap_start;
+    BlockLink_t *block = heap_start.next_free;
+#if HEAP_FIT_POLICY == HEAP_BEST_FIT
+    // Best Fit: walk the whole list, remember the smallest block that fits
+    BlockLink_t *best = NULL, *best_prev = NULL;
+    while (block != heap_end) {
+        if (block->size >= wanted && (best == NULL || block->size < best->size)) {
+            best = block;
+            best_prev = prev;
+            if (block->size == wanted) break; // Can't do better than exact
         }
+        prev = block;
+        block = block->next_free;
     }
-    printf("[Heap] FAILED to allocate %d bytes! (Fragmentation?)\n", size);
-    return -1;
+    block = (best != NULL) ? best : heap_end;
+    prev = best_prev;
+#else
+    // First Fit: stop at the first block that is big enough
+    while (block != heap_end && block->size < wanted) {
+        prev = block;
+        block = block->next_free;
+    }
+#endif
+
+    if (block == heap_end) {
+        printf("[Heap] FAILED to allocate %zu bytes! (Fragmentation?)\n", size);
+        return NULL;
+    }
+
+    // Unlink from the free list
+    prev->next_free = block->next_free;
+
+    // Split: give back the tail if it is big enough to be a block on its own
+    if (block->size - wanted > MIN_BLOCK_SIZE) {
+        BlockLink_t *remainder = (BlockLink_t *)((uint8_t *)block + wanted);
+        remainder->size = block->size - wanted;
+        block->size = wanted;
+        insert_block_into_free_list(remainder);
+    }
+
+    heap_stats.available_bytes -= block->size;
+    if (heap_stats.available_bytes < heap_stats.min_ever_free_bytes) {
+        heap_stats.min_ever_free_bytes = heap_stats.available_bytes;
+    }
+    heap_stats.successful_allocations++;
+
+    block->size |= ALLOCATED_BIT;
+    block->next_free = NULL;
+
+    void *user_ptr = (uint8_t *)block + HEADER_SIZE;
+    printf("[Heap] Allocated %zu bytes at Index %td (block %zu bytes)\n",
+           size, (uint8_t *)user_ptr - heap_memory, block->size & ~ALLOCATED_BIT);
+    return user_ptr;
 }
 
-void heap_free(int start_index, int size) {
-    for (int i = start_index; i < start_index + size; i++) {
-        my_heap.is_allocated[i] = false;
+void heap_free(void *ptr) {
+    if (ptr == NULL) return;
+
+    BlockLink_t *block = (BlockLink_t *)((uint8_t *)ptr - HEADER_SIZE);
+    if ((block->size & ALLOCATED_BIT) == 0 || block->next_free != NULL) {
+        printf("[Heap] ERROR: Index %td is not an allocated block (double free?)\n",
+               (uint8_t *)ptr - heap_memory);
+        return;
     }
-    printf("[Heap] Freed %d bytes at Index %d\n", size, start_index);
+
+    block->size &= ~ALLOCATED_BIT;
+    heap_stats.available_bytes += block->size;
+    heap_stats.successful_frees++;
+    printf("[Heap] Freed %zu bytes at Index %td\n", block->size - HEADER_SIZE, (uint8_t *)ptr - heap_memory);
+
+    insert_block_into_free_list(block);
 }
 
-void print_heap_stats() {
-    int free_bytes = 0;
-    int max_block = 0;
-    int current_block = 0;
-
-    for (int i = 0; i < HEAP_SIZE; i++) {
-        if (!my_heap.is_allocated[i]) {
-            free_bytes++;
-            current_block++;
-        } else {
-            if (current_block > max_block) max_block = current_block;
-            current_block = 0;
+void heap_get_stats(HeapStats_t *stats) {
+    *stats = heap_stats;
+    stats->largest_free_block = 0;
+    stats->smallest_free_block = 0;
+    stats->free_block_count = 0;
+
+    for (BlockLink_t *b = heap_start.next_free; b != heap_end; b = b->next_free) {
+        if (b->size > stats->largest_free_block) stats->largest_free_block = b->size;
+        if (stats->smallest_free_block == 0 || b->size < stats->smallest_free_block) {
+            stats->smallest_free_block = b->size;
         }
+        stats->free_block_count++;
     }
-    if (current_block > max_block) max_block = current_block;
+}
+
+#endif // HEAP_BACKEND
+
+void print_heap_stats() {
+    HeapStats_t s;
+    heap_get_stats(&s);
+
+    // Usable size of the largest block = what the next heap_alloc() can actually get
+    size_t max_block = (s.largest_free_block > HEADER_SIZE) ? s.largest_free_block - HEADER_SIZE : 0;
 
-    printf("Stats: Total Free: %d, Max Contiguous Block: %d\n", free_bytes, max_block);
+    printf("Stats: Total Free: %zu, Max Contiguous Block: %zu, Free Blocks: %zu\n",
+           s.available_bytes, max_block, s.free_block_count);
+    printf("       Low-Water Mark: %zu, Allocs: %zu, Frees: %zu\n",
+           s.min_ever_free_bytes, s.successful_allocations, s.successful_frees);
 }
 
 int main() {
     heap_init();
-    printf("=== Heap Fragmentation Simulation ===\n");
+#if HEAP_BACKEND == HEAP_BACKEND_TLSF
+    printf("=== Heap Fragmentation Simulation (TLSF) ===\n");
+#else
+    printf("=== Heap Fragmentation Simulation (heap_4 style) ===\n");
+#endif
+    printf("Header: %zu bytes, Alignment: %d\n", HEADER_SIZE, HEAP_ALIGNMENT);
     print_heap_stats();
 
     // 1. Allocate 3 blocks
-    int p1 = heap_alloc(20);
-    int p2 = heap_alloc(20);
-    int p3 = heap_alloc(20);
+    void *p1 = heap_alloc(32);
+    void *p2 = heap_alloc(32);
+    void *p3 = heap_alloc(32);
     print_heap_stats();
 
     // 2. Free the MIDDLE block
     // Now we have a hole.
-    heap_free(p2, 20);
+    heap_free(p2);
     print_heap_stats();
 
-    // 3. Try to allocate a large block (40 bytes)
-    // We have 60 bytes free total! (20 in middle + 40 at end)
-    // But do we have 40 *contiguous*?
-    printf("\nTrying to allocate 40 bytes...\n");
-    heap_alloc(40); // Should succeed at the end (Index 60)
+    // 3. Try to allocate a larger block (64 bytes)
+    // The middle hole is too small, but the end of the heap still fits it.
+    printf("\nTrying to allocate 64 bytes...\n");
+    void *p4 = heap_alloc(64);
 
-    // 4. Free the LAST block (p3)
-    heap_free(p3, 20);
+    // 4. Free p4 then p3: each one merges with its free neighbours
+    heap_free(p4);
+    heap_free(p3);
     print_heap_stats();
-    
-    // NOW: We have 20 bytes free at Index 20, and 20 bytes free at Index 40.
-    // Total Free: 80 bytes.
-    // But Max Contiguous: 20 bytes (if no coalescence) or 40 bytes (if coalesced)?
-    // My simple simulator implicitly coalesces because it scans the array.
-    // But imagine if 'p3' was still there.
-    
+
+    // COALESCENCE: p2's hole + p3 + p4 + the tail are now ONE free block.
+    // A byte-map would have to rescan to find that; the free list knows it
+    // at free() time because the neighbours are adjacent in the sorted list.
+    printf("\nTrying to allocate 160 bytes (needs the merged block)...\n");
+    void *big = heap_alloc(160);
+    heap_free(big);
+    heap_free(p1);
+
     printf("\n--- Simulating Bad Fragmentation ---\n");
     // Reset
     heap_init();
-    int a = heap_alloc(30);
-    int b = heap_alloc(10); // Barrier
-    int c = heap_alloc(30);
-    int d = heap_alloc(10); // Barrier
-    
-    heap_free(a, 30); // Free first chunk
-    heap_free(c, 30); // Free third chunk
-    
+    void *a = heap_alloc(64);
+    void *b = heap_alloc(8);  // Barrier
+    void *c = heap_alloc(64);
+    void *d = heap_alloc(8);  // Barrier
+
+    heap_free(a); // Free first chunk
+    heap_free(c); // Free third chunk
+
     print_heap_stats();
-    printf("Total Free is 60... but can I allocate 60?\n");
-    heap_alloc(60); // Fail!
+    printf("Total Free is large... but can I allocate 128?\n");
+    heap_alloc(128); // Fail! Barriers stop a and c from merging.
+
+    heap_free(b);
+    heap_free(d);
+    print_heap_stats(); // Everything merged back into one block
 
     return 0;
 }
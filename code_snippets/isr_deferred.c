@@ -1,83 +1,517 @@
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 /*
  * Deferred Interrupt Processing (Top Half / Bottom Half)
- * 
+ *
  * The Problem: ISRs must be FAST. They block other interrupts.
- * The Solution: 
+ * The Solution:
  * 1. Top Half (ISR): Do the minimum (clear flag, signal task).
  * 2. Bottom Half (Task): Do the heavy work (process data, print, etc).
+ *
+ * The Deferred-Work Queue:
+ * - A single "data + flag" slot loses data as soon as a second interrupt
+ *   arrives before the task runs. Instead, every ISR pushes a small work item
+ *   into a ring of DEFERRED_QUEUE_SIZE slots.
+ * - Lock-free MPSC: several ISRs (nested, or on other cores) may push at once,
+ *   so producers claim a slot with one CAS on 'tail'. Each slot has a sequence
+ *   number that says whether it is free, or filled and ready to read.
+ *   Only the bottom-half task reads, so 'head' needs no atomics.
+ * - Coalescing: the ISR only wakes the task if it isn't already pending. The
+ *   task then drains up to DEFERRED_BATCH_MAX items per wakeup, so a burst of
+ *   bytes costs a few wakeups instead of one per byte.
+ * - When the ring is full the ISR drops the item (it can't wait!) and counts it.
+ *
+ * Latency Instrumentation (host clock):
+ * - Timestamps at IRQ raise (hardware), ISR entry, ISR exit and bottom-half
+ *   completion. clock_gettime(CLOCK_MONOTONIC) by default; build with
+ *   -DLATENCY_USE_RDTSC=1 on x86 for the cheaper TSC (calibrated to ns once).
+ * - Per-IRQ log-bucket histograms (HDR style) for raise->entry, ISR duration
+ *   and raise->bottom-half done. The sweep at the end shows how the tail of
+ *   raise->done moves with the batch size. Pass a file name to dump CSV:
+ *   ./isr_deferred latency.csv
  */
 
+#define DEFERRED_QUEUE_SIZE 16   // Must be a power of 2
+#define DEFERRED_QUEUE_MASK (DEFERRED_QUEUE_SIZE - 1)
+#define DEFERRED_BATCH_MAX  4    // Items handled per bottom-half wakeup
+#define MAX_IRQS            8
+
+#define IRQ_UART 3
+#define IRQ_ADC  5
+
+#ifndef LATENCY_USE_RDTSC
+#define LATENCY_USE_RDTSC 0
+#endif
+
+#define HIST_LINEAR      16  // Exact buckets below this
+#define HIST_SUB_BITS    3   // Then 8 buckets per power of two
+#define HIST_BUCKETS     (HIST_LINEAR + (64 - 4) * (1 << HIST_SUB_BITS))
+
+typedef struct {
+    uint8_t irq;
+    uint32_t data;
+    uint64_t raised_at;          // Timestamp of the hardware event
+} WorkItem_t;
+
+typedef struct {
+    atomic_uint sequence;        // == position: free. == position + 1: filled.
+    WorkItem_t item;
+} WorkSlot_t;
+
+typedef struct {
+    WorkSlot_t slots[DEFERRED_QUEUE_SIZE];
+    atomic_uint tail;            // Next position to claim (producers, CAS)
+    unsigned int head;           // Next position to read (consumer only)
+} WorkQueue_t;
+
+typedef struct {
+    atomic_uint queued;
+    atomic_uint dropped;
+    atomic_uint processed;
+} IrqStats_t;
+
+typedef void (*DeferredHandler_t)(uint32_t data);
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} LatencyHistogram_t;
+
+// Latency stages per IRQ, all in ns
+typedef enum { STAGE_RAISE_TO_ENTRY, STAGE_ISR_DURATION, STAGE_RAISE_TO_DONE, NUM_STAGES } LatencyStage_t;
+static const char *stage_names[NUM_STAGES] = { "raise_to_entry", "isr_duration", "raise_to_done" };
+
+static bool verbose = true; // Off during the sweep
+#define LOG(...) do { if (verbose) printf(__VA_ARGS__); } while (0)
+
 // Simulated Hardware Flag
 volatile int uart_data_register = 0;
 volatile bool interrupt_flag = false;
 
-// Simulated OS Queue (Simple variable for demo)
-int data_queue = 0;
-bool queue_has_data = false;
+static WorkQueue_t work_queue;
+static IrqStats_t irq_stats[MAX_IRQS];
+static DeferredHandler_t deferred_handlers[MAX_IRQS];
+static atomic_bool bottom_half_pending;   // Task already signaled?
+static unsigned int bottom_half_wakeups = 0; // Signals sent by ISRs
+static unsigned int bottom_half_runs = 0;    // Batches actually run
+static int deferred_batch_max = DEFERRED_BATCH_MAX;
+
+static uint64_t irq_raised_at[MAX_IRQS];    // Set by the "hardware"
+static LatencyHistogram_t latency_hist[MAX_IRQS][NUM_STAGES];
+
+// --- Timestamps ---
+
+#if LATENCY_USE_RDTSC && (defined(__x86_64__) || defined(__i386__))
+static double tsc_per_ns = 1.0;
+
+static uint64_t timestamp() {
+    return __rdtsc();
+}
+#else
+static uint64_t timestamp() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+static uint64_t ticks_to_ns(uint64_t ticks) {
+#if LATENCY_USE_RDTSC && (defined(__x86_64__) || defined(__i386__))
+    return (uint64_t)((double)ticks / tsc_per_ns);
+#else
+    return ticks;
+#endif
+}
+
+// Measure the TSC rate against the monotonic clock (no-op for clock_gettime)
+static void timestamp_calibrate() {
+#if LATENCY_USE_RDTSC && (defined(__x86_64__) || defined(__i386__))
+    struct timespec a, b;
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    uint64_t t0 = __rdtsc();
+    do { clock_gettime(CLOCK_MONOTONIC, &b); }
+    while ((b.tv_sec - a.tv_sec) * 1000000000ll + (b.tv_nsec - a.tv_nsec) < 20000000);
+    uint64_t t1 = __rdtsc();
+    tsc_per_ns = (double)(t1 - t0) / (double)((b.tv_sec - a.tv_sec) * 1000000000ll + (b.tv_nsec - a.tv_nsec));
+#endif
+}
+
+// --- Log-bucket histogram ---
+
+static int hist_index(uint64_t value) {
+    if (value < HIST_LINEAR) return (int)value;
+    int exp = 63 - __builtin_clzll(value);
+    int sub = (int)((value >> (exp - HIST_SUB_BITS)) & ((1 << HIST_SUB_BITS) - 1));
+    return HIST_LINEAR + (exp - 4) * (1 << HIST_SUB_BITS) + sub;
+}
+
+static uint64_t hist_bucket_low(int index) {
+    if (index < HIST_LINEAR) return (uint64_t)index;
+    int exp = (index - HIST_LINEAR) / (1 << HIST_SUB_BITS) + 4;
+    int sub = (index - HIST_LINEAR) % (1 << HIST_SUB_BITS);
+    return (uint64_t)((1 << HIST_SUB_BITS) + sub) << (exp - HIST_SUB_BITS);
+}
+
+static uint64_t hist_bucket_high(int index) {
+    return (index + 1 < HIST_BUCKETS) ? hist_bucket_low(index + 1) - 1 : UINT64_MAX;
+}
+
+static void hist_record(LatencyHistogram_t *h, uint64_t value) {
+    h->counts[hist_index(value)]++;
+    h->total++;
+    if (value > h->max) h->max = value;
+}
+
+static uint64_t hist_percentile(const LatencyHistogram_t *h, double p) {
+    if (h->total == 0) return 0;
+    uint64_t rank = (uint64_t)(p * (double)h->total + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) return (hist_bucket_high(i) < h->max) ? hist_bucket_high(i) : h->max;
+    }
+    return h->max;
+}
+
+static void latency_record(uint8_t irq, LatencyStage_t stage, uint64_t from, uint64_t to) {
+    hist_record(&latency_hist[irq][stage], ticks_to_ns(to - from));
+}
+
+// Simulated hardware: the IRQ line goes active now
+void hw_raise_irq(uint8_t irq) {
+    irq_raised_at[irq] = timestamp();
+    if (irq == IRQ_UART) interrupt_flag = true;
+}
+
+void work_queue_init(WorkQueue_t *q) {
+    for (unsigned int i = 0; i < DEFERRED_QUEUE_SIZE; i++) {
+        atomic_init(&q->slots[i].sequence, i);
+    }
+    atomic_init(&q->tail, 0);
+    q->head = 0;
+}
+
+// ISR side (any number of producers). Returns false if the ring is full.
+bool work_queue_push(WorkQueue_t *q, const WorkItem_t *item) {
+    unsigned int pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    WorkSlot_t *slot;
+
+    for (;;) {
+        slot = &q->slots[pos & DEFERRED_QUEUE_MASK];
+        unsigned int seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int diff = (int)(seq - pos);
+        if (diff == 0) {
+            // Slot is free for this position: try to claim it
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+            // CAS failed: 'pos' now holds the new tail, retry
+        } else if (diff < 0) {
+            return false; // Consumer hasn't freed this slot yet: full
+        } else {
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed); // Someone else got it
+        }
+    }
+
+    slot->item = *item;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release); // Publish
+    return true;
+}
+
+// Task side: is the next item published?
+bool work_queue_ready(WorkQueue_t *q) {
+    WorkSlot_t *slot = &q->slots[q->head & DEFERRED_QUEUE_MASK];
+    return atomic_load_explicit(&slot->sequence, memory_order_acquire) == q->head + 1;
+}
+
+// Task side (single consumer). Returns false if nothing is ready.
+bool work_queue_pop(WorkQueue_t *q, WorkItem_t *item) {
+    WorkSlot_t *slot = &q->slots[q->head & DEFERRED_QUEUE_MASK];
+    unsigned int seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (seq != q->head + 1) return false; // Empty (or a producer is still writing it)
+
+    *item = slot->item;
+    atomic_store_explicit(&slot->sequence, q->head + DEFERRED_QUEUE_SIZE, memory_order_release); // Free
+    q->head++;
+    return true;
+}
+
+void deferred_register(uint8_t irq, DeferredHandler_t handler) {
+    deferred_handlers[irq] = handler;
+}
+
+// Called from ANY ISR: queue the work, wake the bottom half only if needed
+bool deferred_submit_from_isr(uint8_t irq, uint32_t data) {
+    WorkItem_t item = { .irq = irq, .data = data, .raised_at = irq_raised_at[irq] };
+    if (!work_queue_push(&work_queue, &item)) {
+        atomic_fetch_add_explicit(&irq_stats[irq].dropped, 1, memory_order_relaxed);
+        return false;
+    }
+    atomic_fetch_add_explicit(&irq_stats[irq].queued, 1, memory_order_relaxed);
+
+    // Coalescing: one wakeup covers everything queued until the task runs
+    if (!atomic_exchange_explicit(&bottom_half_pending, true, memory_order_acq_rel)) {
+        bottom_half_wakeups++; // In a real RTOS: vTaskNotifyGiveFromISR + portYIELD_FROM_ISR
+    }
+    return true;
+}
 
 // --- The Top Half (ISR) ---
 // MUST be fast. No printf, no heavy math, no blocking.
 void UART_ISR() {
+    uint64_t entry = timestamp();
+    latency_record(IRQ_UART, STAGE_RAISE_TO_ENTRY, irq_raised_at[IRQ_UART], entry);
+
     // 1. Read Data from Hardware
     int data = uart_data_register;
-    
+
     // 2. Clear Interrupt Flag (Simulated)
     interrupt_flag = false;
-    
-    // 3. Send to Queue (Signal the Task)
-    data_queue = data;
-    queue_has_data = true;
-    
+
+    // 3. Queue the work (Signal the Task)
+    deferred_submit_from_isr(IRQ_UART, (uint32_t)data);
+
     // 4. Request Context Switch (in real RTOS: portYIELD_FROM_ISR)
     // printf("ISR: Received %d. Signaled Task.\n", data); // BAD PRACTICE in real ISR!
+    latency_record(IRQ_UART, STAGE_ISR_DURATION, entry, timestamp());
+}
+
+void ADC_ISR(uint32_t sample) {
+    uint64_t entry = timestamp();
+    latency_record(IRQ_ADC, STAGE_RAISE_TO_ENTRY, irq_raised_at[IRQ_ADC], entry);
+    deferred_submit_from_isr(IRQ_ADC, sample);
+    latency_record(IRQ_ADC, STAGE_ISR_DURATION, entry, timestamp());
 }
 
 // --- The Bottom Half (Task) ---
 // Can take its time. Can block.
-void UART_Processing_Task() {
-    if (queue_has_data) {
-        // 1. Read from Queue
-        int data = data_queue;
-        queue_has_data = false;
-        
-        // 2. Process Data (Heavy work)
-        printf("Task: Processing data %d... ", data);
-        printf("[Complex Math]... ");
-        printf("Done.\n");
-    } else {
+void UART_Process(uint32_t data) {
+    // Process Data (Heavy work)
+    LOG("  Task: Processing UART data 0x%02X... [Complex Math]... Done.\n", data);
+}
+
+void ADC_Process(uint32_t sample) {
+    LOG("  Task: Filtering ADC sample %u... Done.\n", sample);
+}
+
+// One wakeup: handle at most deferred_batch_max items, re-arm if more are waiting
+void Deferred_Work_Task() {
+    atomic_store_explicit(&bottom_half_pending, false, memory_order_seq_cst);
+    bottom_half_runs++;
+
+    WorkItem_t item;
+    int handled = 0;
+    while (handled < deferred_batch_max && work_queue_pop(&work_queue, &item)) {
+        if (deferred_handlers[item.irq] != NULL) deferred_handlers[item.irq](item.data);
+        atomic_fetch_add_explicit(&irq_stats[item.irq].processed, 1, memory_order_relaxed);
+        latency_record(item.irq, STAGE_RAISE_TO_DONE, item.raised_at, timestamp());
+        handled++;
+    }
+    LOG("Task: Batch done (%d items).\n", handled);
+
+    // Leftovers: yield so other tasks can run, and come back for the rest
+    if (work_queue_ready(&work_queue)) {
+        atomic_store_explicit(&bottom_half_pending, true, memory_order_release);
+    }
+}
+
+// Scheduler: run the bottom half while it has been signaled
+void run_scheduler() {
+    if (!atomic_load(&bottom_half_pending)) {
         printf("Task: Waiting for data...\n");
+        return;
+    }
+    while (atomic_load(&bottom_half_pending)) {
+        Deferred_Work_Task();
+    }
+}
+
+void print_irq_stats() {
+    printf("\n%-6s %8s %8s %10s\n", "IRQ", "Queued", "Dropped", "Processed");
+    for (int irq = 0; irq < MAX_IRQS; irq++) {
+        unsigned int queued = atomic_load(&irq_stats[irq].queued);
+        unsigned int dropped = atomic_load(&irq_stats[irq].dropped);
+        if (queued == 0 && dropped == 0) continue;
+        printf("%-6d %8u %8u %10u\n", irq, queued, dropped, atomic_load(&irq_stats[irq].processed));
+    }
+    printf("Bottom-half wakeups from ISRs: %u, batches run: %u (batch max %d)\n",
+           bottom_half_wakeups, bottom_half_runs, deferred_batch_max);
+}
+
+void print_latency() {
+    printf("\n%-4s %-15s %8s %8s %8s %8s %8s\n", "IRQ", "Stage (ns)", "Count", "p50", "p99", "p99.9", "max");
+    for (int irq = 0; irq < MAX_IRQS; irq++) {
+        for (int stage = 0; stage < NUM_STAGES; stage++) {
+            const LatencyHistogram_t *h = &latency_hist[irq][stage];
+            if (h->total == 0) continue;
+            printf("%-4d %-15s %8llu %8llu %8llu %8llu %8llu\n", irq, stage_names[stage],
+                   (unsigned long long)h->total,
+                   (unsigned long long)hist_percentile(h, 0.50),
+                   (unsigned long long)hist_percentile(h, 0.99),
+                   (unsigned long long)hist_percentile(h, 0.999),
+                   (unsigned long long)h->max);
+        }
+    }
+}
+
+void latency_dump_csv(FILE *f, const char *config) {
+    for (int irq = 0; irq < MAX_IRQS; irq++) {
+        for (int stage = 0; stage < NUM_STAGES; stage++) {
+            const LatencyHistogram_t *h = &latency_hist[irq][stage];
+            for (int i = 0; i < HIST_BUCKETS; i++) {
+                if (h->counts[i] == 0) continue;
+                fprintf(f, "%s,%d,%s,%llu,%llu,%llu\n", config, irq, stage_names[stage],
+                        (unsigned long long)hist_bucket_low(i), (unsigned long long)hist_bucket_high(i),
+                        (unsigned long long)h->counts[i]);
+            }
+        }
     }
 }
 
-int main() {
+static void reset_deferred_state() {
+    work_queue_init(&work_queue);
+    memset(irq_stats, 0, sizeof(irq_stats));
+    memset(latency_hist, 0, sizeof(latency_hist));
+    atomic_store(&bottom_half_pending, false);
+    bottom_half_wakeups = 0;
+    bottom_half_runs = 0;
+}
+
+// Busy "work" so the timestamps have something to measure
+static void spin_ns(uint64_t ns) {
+    uint64_t start = timestamp();
+    while (ticks_to_ns(timestamp() - start) < ns) { }
+}
+
+static void UART_Process_Quiet(uint32_t data) {
+    (void)data;
+    spin_ns(300); // Parse one byte
+}
+
+// Bursty UART traffic; the bottom half gets ONE batch per scheduler round,
+// then other tasks run for a while. How does the batch size move the tail?
+void run_latency_sweep(int batch_max, FILE *csv) {
+    reset_deferred_state();
+    deferred_batch_max = batch_max;
+    deferred_register(IRQ_UART, UART_Process_Quiet);
+    verbose = false;
+
+    srand(42); // Same traffic for every configuration
+    for (int round = 0; round < 2000; round++) {
+        int burst = rand() % 8;
+        for (int i = 0; i < burst; i++) {
+            uart_data_register = rand() & 0xFF;
+            hw_raise_irq(IRQ_UART);
+            UART_ISR();
+        }
+        if (atomic_load(&bottom_half_pending)) Deferred_Work_Task();
+        spin_ns(1000); // Other tasks
+    }
+    while (atomic_load(&bottom_half_pending)) Deferred_Work_Task(); // Drain the rest
+
+    verbose = true;
+    deferred_register(IRQ_UART, UART_Process);
+
+    const LatencyHistogram_t *h = &latency_hist[IRQ_UART][STAGE_RAISE_TO_DONE];
+    printf("%9d %8llu %8llu %8llu %10llu %8u %8u\n", batch_max,
+           (unsigned long long)hist_percentile(h, 0.50), (unsigned long long)hist_percentile(h, 0.99),
+           (unsigned long long)hist_percentile(h, 0.999), (unsigned long long)h->max,
+           atomic_load(&irq_stats[IRQ_UART].dropped), bottom_half_runs);
+
+    if (csv != NULL) {
+        char config[32];
+        snprintf(config, sizeof(config), "batch_%d", batch_max);
+        latency_dump_csv(csv, config);
+    }
+}
+
+int main(int argc, char **argv) {
     printf("--- System Start ---\n");
-    
+    timestamp_calibrate();
+    work_queue_init(&work_queue);
+    deferred_register(IRQ_UART, UART_Process);
+    deferred_register(IRQ_ADC, ADC_Process);
+
     // 1. Simulate Hardware Event
     printf("\n[Hardware]: Data 0xAA arrives!\n");
     uart_data_register = 0xAA;
-    interrupt_flag = true;
-    
+    hw_raise_irq(IRQ_UART);
+
     // 2. Interrupt Fires!
     if (interrupt_flag) {
         UART_ISR();
     }
-    
+
     // 3. Scheduler runs the Task
-    UART_Processing_Task();
-    
-    // 4. Simulate another event
+    run_scheduler();
+
+    // 4. Simulate another event, and an idle pass
     printf("\n[Hardware]: Data 0xBB arrives!\n");
     uart_data_register = 0xBB;
-    interrupt_flag = true;
-    
+    hw_raise_irq(IRQ_UART);
+
     if (interrupt_flag) {
         UART_ISR();
     }
-    
-    UART_Processing_Task();
+
+    run_scheduler();
+    run_scheduler();
+
+    // 5. Burst: 10 UART bytes + ADC samples arrive before the task gets the CPU
+    printf("\n[Hardware]: Burst of 10 UART bytes + 3 ADC samples!\n");
+    for (int i = 0; i < 10; i++) {
+        uart_data_register = 0x30 + i;
+        hw_raise_irq(IRQ_UART);
+        UART_ISR();
+        if (i % 3 == 0) {
+            hw_raise_irq(IRQ_ADC);
+            ADC_ISR(1000 + i);
+        }
+    }
+    run_scheduler(); // Batches of DEFERRED_BATCH_MAX, still only one ISR wakeup
+
+    // 6. Overload: more than the ring holds before the task runs
+    printf("\n[Hardware]: Flood of 20 UART bytes (ring holds %d)!\n", DEFERRED_QUEUE_SIZE);
+    for (int i = 0; i < 20; i++) {
+        uart_data_register = 0x60 + i;
+        hw_raise_irq(IRQ_UART);
+        UART_ISR();
+    }
+    run_scheduler();
+
+    print_irq_stats();
+    print_latency();
+
+    // 7. Tail latency vs batch size (raise -> bottom half done, ns)
+    printf("\n--- Latency Sweep: bursty UART, one batch per scheduler round ---\n");
+    FILE *csv = NULL;
+    if (argc > 1) {
+        csv = fopen(argv[1], "w");
+        if (csv == NULL) perror(argv[1]);
+        else fprintf(csv, "config,irq,stage,bucket_low_ns,bucket_high_ns,count\n");
+    }
+    printf("%9s %8s %8s %8s %10s %8s %8s\n", "BatchMax", "p50", "p99", "p99.9", "max", "Dropped", "Batches");
+    int batch_sizes[] = { 1, 2, 4, 16 };
+    for (size_t i = 0; i < sizeof(batch_sizes) / sizeof(batch_sizes[0]); i++) {
+        run_latency_sweep(batch_sizes[i], csv);
+    }
+    if (csv != NULL) {
+        fclose(csv);
+        printf("Histograms written to %s\n", argv[1]);
+    }
 
     return 0;
 }
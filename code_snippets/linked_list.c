@@ -1,111 +1,275 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
 
 /*
  * Doubly Linked List
  * The backbone of an RTOS Scheduler.
- * Used for: Ready List, Blocked List, Suspended List.
+ * Used for: Ready List, Blocked List, Suspended List, Delayed List,
+ *           queue wait lists, timer lists.
+ *
+ * Modeled on FreeRTOS xLIST (list.h / list.c):
+ * - INTRUSIVE: the item lives inside the TCB (or timer, or queue), so
+ *   inserting never allocates. One TCB holds two items and can be in two
+ *   lists at once: its state list (ready/delayed) and an event list.
+ * - SENTINEL: every list has a permanent end marker, xListEnd. The list is
+ *   a circle through it, so it is never "empty" as far as the pointers are
+ *   concerned. Insert and remove always have a neighbour on both sides, and
+ *   there are no NULL checks and no head/tail special cases.
+ * - BACK POINTERS: each item knows its owner (pvOwner) and the list it is in
+ *   (pxContainer). Removing needs only the item: O(1), no search.
+ * - SORTED INSERT on xItemValue (a wake tick, or a priority) for delayed and
+ *   wait lists. The sentinel holds the largest value, so the scan stops
+ *   there without a separate end check.
+ * - pxIndex CURSOR: round robin among equal-priority tasks without moving
+ *   any node. The next owner is O(1).
  */
 
-// 1. The Node (Represents a Task in the list)
-typedef struct Node {
-    struct Node *next;
-    struct Node *prev;
-    int task_id;       // In a real RTOS, this would be the TCB
-    int priority;
-} Node_t;
+typedef uint32_t TickType_t;
+typedef uint32_t UBaseType_t;
+#define portMAX_DELAY 0xFFFFFFFFu
 
-// 2. The List (Represents a Queue, e.g., "Ready Queue")
-typedef struct {
-    Node_t *head;
-    Node_t *tail;
-    int count;
+struct xLIST;
+
+// 1. The Item (embedded in whatever goes into a list)
+typedef struct xLIST_ITEM {
+    TickType_t xItemValue;           // Sort key: wake tick, priority, ...
+    struct xLIST_ITEM *pxNext;
+    struct xLIST_ITEM *pxPrevious;
+    void *pvOwner;                   // The TCB (or timer...) this item is part of
+    struct xLIST *pxContainer;       // List the item is in, NULL = none
+} ListItem_t;
+
+// 2. The List. The end marker is a full item to keep things simple; FreeRTOS
+// can shrink it to a MiniListItem_t (no owner/container) to save 8 bytes.
+typedef struct xLIST {
+    UBaseType_t uxNumberOfItems;
+    ListItem_t *pxIndex;             // Round-robin cursor
+    ListItem_t xListEnd;             // Sentinel, always the largest value
 } List_t;
 
-// Initialize the list
-void list_init(List_t *list) {
-    list->head = NULL;
-    list->tail = NULL;
-    list->count = 0;
+#define listSET_LIST_ITEM_OWNER(pxItem, pxOwner)  ((pxItem)->pvOwner = (void *)(pxOwner))
+#define listGET_LIST_ITEM_OWNER(pxItem)           ((pxItem)->pvOwner)
+#define listSET_LIST_ITEM_VALUE(pxItem, xValue)   ((pxItem)->xItemValue = (xValue))
+#define listGET_LIST_ITEM_VALUE(pxItem)           ((pxItem)->xItemValue)
+#define listCURRENT_LIST_LENGTH(pxList)           ((pxList)->uxNumberOfItems)
+#define listLIST_IS_EMPTY(pxList)                 ((pxList)->uxNumberOfItems == 0)
+#define listIS_CONTAINED_WITHIN(pxList, pxItem)   ((pxItem)->pxContainer == (pxList))
+#define listGET_ITEM_VALUE_OF_HEAD_ENTRY(pxList)  ((pxList)->xListEnd.pxNext->xItemValue)
+#define listGET_OWNER_OF_HEAD_ENTRY(pxList)       ((pxList)->xListEnd.pxNext->pvOwner)
+
+// Move the cursor one step (stepping over the end marker) and return its owner.
+// The scheduler calls this on every tick to round robin one priority level.
+#define listGET_OWNER_OF_NEXT_ENTRY(pxTCB, pxList)                          \
+    do {                                                                    \
+        List_t *const pxConstList = (pxList);                               \
+        pxConstList->pxIndex = pxConstList->pxIndex->pxNext;                \
+        if (pxConstList->pxIndex == &pxConstList->xListEnd) {               \
+            pxConstList->pxIndex = pxConstList->pxIndex->pxNext;            \
+        }                                                                   \
+        (pxTCB) = pxConstList->pxIndex->pvOwner;                            \
+    } while (0)
+
+// Initialize the list: the end marker points at itself
+void vListInitialise(List_t *pxList) {
+    pxList->xListEnd.xItemValue = portMAX_DELAY;
+    pxList->xListEnd.pxNext = &pxList->xListEnd;
+    pxList->xListEnd.pxPrevious = &pxList->xListEnd;
+    pxList->xListEnd.pvOwner = NULL;
+    pxList->xListEnd.pxContainer = pxList;
+    pxList->pxIndex = &pxList->xListEnd;
+    pxList->uxNumberOfItems = 0;
+}
+
+void vListInitialiseItem(ListItem_t *pxItem) {
+    pxItem->pxContainer = NULL; // Not in any list yet
+}
+
+// Add an item so it is the LAST one the cursor reaches (Round Robin insertion):
+// it goes just before pxIndex. Always has two neighbours, so no branches.
+void vListInsertEnd(List_t *pxList, ListItem_t *pxNewListItem) {
+    ListItem_t *const pxIndex = pxList->pxIndex;
+    pxNewListItem->pxNext = pxIndex;
+    pxNewListItem->pxPrevious = pxIndex->pxPrevious;
+    pxIndex->pxPrevious->pxNext = pxNewListItem;
+    pxIndex->pxPrevious = pxNewListItem;
+    pxNewListItem->pxContainer = pxList;
+    pxList->uxNumberOfItems++;
 }
 
-// Add a task to the END of the list (Round Robin insertion)
-void list_insert_end(List_t *list, Node_t *new_node) {
-    if (list->head == NULL) {
-        // List is empty
-        list->head = new_node;
-        list->tail = new_node;
-        new_node->next = NULL;
-        new_node->prev = NULL;
+// Add an item in xItemValue order, after any items with the same value so
+// equal wake ticks stay FIFO. The scan needs no end check: xListEnd holds
+// portMAX_DELAY, which stops it (that value itself goes straight to the end).
+void vListInsert(List_t *pxList, ListItem_t *pxNewListItem) {
+    const TickType_t xValueOfInsertion = pxNewListItem->xItemValue;
+    ListItem_t *pxIterator;
+
+    if (xValueOfInsertion == portMAX_DELAY) {
+        pxIterator = pxList->xListEnd.pxPrevious;
     } else {
-        // Add to tail
-        list->tail->next = new_node; // Old tail points to new
-        new_node->prev = list->tail; // New points back to old tail
-        new_node->next = NULL;       // New is now the end
-        list->tail = new_node;       // Update tail pointer
+        for (pxIterator = &pxList->xListEnd; pxIterator->pxNext->xItemValue <= xValueOfInsertion;
+             pxIterator = pxIterator->pxNext) {
+            // Just walking
+        }
     }
-    list->count++;
+
+    pxNewListItem->pxNext = pxIterator->pxNext;
+    pxNewListItem->pxNext->pxPrevious = pxNewListItem;
+    pxNewListItem->pxPrevious = pxIterator;
+    pxIterator->pxNext = pxNewListItem;
+    pxNewListItem->pxContainer = pxList;
+    pxList->uxNumberOfItems++;
 }
 
-// Remove a task from the list (e.g., when it blocks or is deleted)
-void list_remove(List_t *list, Node_t *node) {
-    if (list->head == NULL || node == NULL) return;
+// Remove an item from whatever list it is in (when it blocks, wakes or is
+// deleted). Returns how many items are left in that list.
+UBaseType_t uxListRemove(ListItem_t *pxItemToRemove) {
+    List_t *const pxList = pxItemToRemove->pxContainer;
 
-    // If node is head
-    if (node == list->head) {
-        list->head = node->next;
-    }
+    pxItemToRemove->pxNext->pxPrevious = pxItemToRemove->pxPrevious;
+    pxItemToRemove->pxPrevious->pxNext = pxItemToRemove->pxNext;
 
-    // If node is tail
-    if (node == list->tail) {
-        list->tail = node->prev;
+    // Keep the cursor on a live item
+    if (pxList->pxIndex == pxItemToRemove) {
+        pxList->pxIndex = pxItemToRemove->pxPrevious;
     }
 
-    // Unlink from neighbors
-    if (node->next != NULL) {
-        node->next->prev = node->prev;
-    }
-    if (node->prev != NULL) {
-        node->prev->next = node->next;
+    pxItemToRemove->pxContainer = NULL;
+    return --pxList->uxNumberOfItems;
+}
+
+// --- A TCB with two embedded items, as in FreeRTOS tasks.c ---
+typedef struct {
+    int task_id;
+    UBaseType_t uxPriority;
+    ListItem_t xStateListItem; // Ready, delayed or suspended list
+    ListItem_t xEventListItem; // Wait list of a queue/semaphore, sorted by priority
+} TCB_t;
+
+#define configMAX_PRIORITIES 8
+
+void tcb_init(TCB_t *tcb, int id, UBaseType_t prio) {
+    tcb->task_id = id;
+    tcb->uxPriority = prio;
+    vListInitialiseItem(&tcb->xStateListItem);
+    vListInitialiseItem(&tcb->xEventListItem);
+    listSET_LIST_ITEM_OWNER(&tcb->xStateListItem, tcb);
+    listSET_LIST_ITEM_OWNER(&tcb->xEventListItem, tcb);
+    listSET_LIST_ITEM_VALUE(&tcb->xStateListItem, 0);
+    // Event lists sort ascending, so store the inverted priority: highest first
+    listSET_LIST_ITEM_VALUE(&tcb->xEventListItem, configMAX_PRIORITIES - prio);
+}
+
+void print_list(const char *name, List_t *list) {
+    printf("%s (Count %u): ", name, (unsigned)listCURRENT_LIST_LENGTH(list));
+    for (ListItem_t *item = list->xListEnd.pxNext; item != &list->xListEnd; item = item->pxNext) {
+        TCB_t *tcb = listGET_LIST_ITEM_OWNER(item);
+        printf("[Task %d v=%u] <-> ", tcb->task_id, (unsigned)listGET_LIST_ITEM_VALUE(item));
     }
+    printf("END\n");
+}
 
-    node->next = NULL;
-    node->prev = NULL;
-    list->count--;
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
 }
 
-void print_list(List_t *list) {
-    Node_t *current = list->head;
-    printf("List (Count %d): ", list->count);
-    while (current != NULL) {
-        printf("[Task %d] <-> ", current->task_id);
-        current = current->next;
+// The hot paths: a task switch (cursor step), and a task that blocks and
+// later wakes (remove from ready, back in at the end)
+static void run_benchmark() {
+    enum { TASKS = 1000, ROUNDS = 2000000 };
+    TCB_t *tcbs = malloc(TASKS * sizeof(TCB_t));
+    if (tcbs == NULL) return;
+    List_t ready;
+    vListInitialise(&ready);
+    for (int i = 0; i < TASKS; i++) {
+        tcb_init(&tcbs[i], i, 1);
+        vListInsertEnd(&ready, &tcbs[i].xStateListItem);
+    }
+
+    TCB_t *pxCurrentTCB = NULL;
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < ROUNDS; i++) listGET_OWNER_OF_NEXT_ENTRY(pxCurrentTCB, &ready);
+    uint64_t t1 = now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        TCB_t *tcb = &tcbs[i % TASKS];
+        uxListRemove(&tcb->xStateListItem);
+        vListInsertEnd(&ready, &tcb->xStateListItem);
     }
-    printf("NULL\n");
+    uint64_t t2 = now_ns();
+
+    printf("Next owner (round robin): %.1f ns, remove + insert end: %.1f ns (last task %d)\n",
+           (double)(t1 - t0) / ROUNDS, (double)(t2 - t1) / ROUNDS, pxCurrentTCB->task_id);
+    free(tcbs);
 }
 
 int main() {
     List_t ready_list;
-    list_init(&ready_list);
+    vListInitialise(&ready_list);
 
     // Create some dummy tasks
-    Node_t t1 = { .task_id = 1, .priority = 2 };
-    Node_t t2 = { .task_id = 2, .priority = 2 };
-    Node_t t3 = { .task_id = 3, .priority = 1 };
+    TCB_t t1, t2, t3, t4;
+    tcb_init(&t1, 1, 2);
+    tcb_init(&t2, 2, 2);
+    tcb_init(&t3, 3, 1);
+    tcb_init(&t4, 4, 3);
 
     printf("1. Adding Tasks...\n");
-    list_insert_end(&ready_list, &t1);
-    list_insert_end(&ready_list, &t2);
-    list_insert_end(&ready_list, &t3);
-    print_list(&ready_list);
-
-    printf("2. Removing Task 2 (Middle)...\n");
-    list_remove(&ready_list, &t2);
-    print_list(&ready_list);
-
-    printf("3. Removing Task 1 (Head)...\n");
-    list_remove(&ready_list, &t1);
-    print_list(&ready_list);
+    vListInsertEnd(&ready_list, &t1.xStateListItem);
+    vListInsertEnd(&ready_list, &t2.xStateListItem);
+    vListInsertEnd(&ready_list, &t3.xStateListItem);
+    print_list("Ready", &ready_list);
+
+    printf("2. Round robin with the cursor (no node moves)...\n");
+    TCB_t *pxCurrentTCB;
+    for (int i = 0; i < 5; i++) {
+        listGET_OWNER_OF_NEXT_ENTRY(pxCurrentTCB, &ready_list);
+        printf("  tick %d: run Task %d\n", i, pxCurrentTCB->task_id);
+    }
+
+    printf("3. Removing Task 2 (Middle) by its item alone...\n");
+    UBaseType_t left = uxListRemove(&t2.xStateListItem);
+    printf("  %u left, Task 2 still listed? %s\n", (unsigned)left,
+           listIS_CONTAINED_WITHIN(&ready_list, &t2.xStateListItem) ? "YES" : "NO");
+    print_list("Ready", &ready_list);
+
+    printf("4. Delayed list, sorted by wake tick...\n");
+    List_t delayed_list;
+    vListInitialise(&delayed_list);
+    TickType_t wake[4] = { 50, 10, 30, 10 };
+    TCB_t *sleepers[4] = { &t1, &t2, &t3, &t4 };
+    for (int i = 0; i < 4; i++) {
+        TCB_t *tcb = sleepers[i];
+        if (tcb->xStateListItem.pxContainer != NULL) uxListRemove(&tcb->xStateListItem);
+        listSET_LIST_ITEM_VALUE(&tcb->xStateListItem, wake[i]);
+        vListInsert(&delayed_list, &tcb->xStateListItem);
+    }
+    print_list("Delayed", &delayed_list);
+    TCB_t *next_wake = listGET_OWNER_OF_HEAD_ENTRY(&delayed_list);
+    printf("  Next wake: tick %u (Task %d), ready list empty? %s\n",
+           (unsigned)listGET_ITEM_VALUE_OF_HEAD_ENTRY(&delayed_list), next_wake->task_id,
+           listLIST_IS_EMPTY(&ready_list) ? "YES" : "NO");
+
+    printf("5. One TCB in two lists: delayed AND waiting on a queue...\n");
+    List_t queue_waiters;
+    vListInitialise(&queue_waiters);
+    vListInsert(&queue_waiters, &t3.xEventListItem); // Prio 1
+    vListInsert(&queue_waiters, &t4.xEventListItem); // Prio 3: goes first
+    vListInsert(&queue_waiters, &t1.xEventListItem); // Prio 2
+    print_list("Queue waiters", &queue_waiters);
+    TCB_t *woken = listGET_OWNER_OF_HEAD_ENTRY(&queue_waiters);
+    uxListRemove(&woken->xEventListItem); // Data arrived: highest priority waiter wins
+    uxListRemove(&woken->xStateListItem); // ...and leaves the delayed list too
+    vListInsertEnd(&ready_list, &woken->xStateListItem);
+    printf("  Task %d woken by the queue before its timeout\n", woken->task_id);
+    print_list("Delayed", &delayed_list);
+    print_list("Ready", &ready_list);
+
+    printf("6. Hot path cost...\n");
+    run_benchmark();
 
     return 0;
 }
@@ -0,0 +1,379 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Phase 5: Fixed-Size Block Pools (Memory Pools / Partitions)
+ *
+ * The Problem:
+ * - Kernel objects (TCBs, queue items, timers) are created and deleted all the time.
+ * - A general heap (heap_fragmentation.c) searches, splits and merges -> slow + fragments.
+ * - But these objects always have the SAME size!
+ *
+ * The Solution: One pool per object type.
+ * - A pool is an array of N equal blocks.
+ * - Free blocks are chained together through their OWN memory
+ *   (the first word of a free block is the "next" pointer -> zero overhead).
+ * - Alloc = pop the head of the free list. Free = push it back. Both O(1).
+ * - No fragmentation possible: any free block fits any request.
+ *
+ * Extras:
+ * - Per-core cache (POOL_USE_CORE_CACHE): each core keeps a few blocks of its
+ *   own, so most alloc/free calls never touch the shared (locked) free list.
+ *   When the shared list is empty too, an alloc takes a block from another
+ *   core's cache. The pool only fails when EVERY block is in use.
+ * - Debug poisoning (POOL_DEBUG_POISON): free blocks are filled with a pattern.
+ *   If the pattern changed when the block is handed out again, someone
+ *   wrote to it after free() (use-after-free). Double frees are caught too.
+ */
+
+#ifndef POOL_USE_CORE_CACHE
+#define POOL_USE_CORE_CACHE 1
+#endif
+#ifndef POOL_DEBUG_POISON
+#define POOL_DEBUG_POISON 1
+#endif
+
+#define POOL_NUM_CORES   2
+#define POOL_CACHE_SIZE  8                     // Blocks held per core
+#define POOL_CACHE_BATCH (POOL_CACHE_SIZE / 2) // Moved per trip to the shared list
+
+#define POISON_FREE  0xDE // Pattern written into free blocks
+#define POISON_ALLOC 0xCD // Pattern written into freshly allocated blocks
+
+// A free block reuses its own storage as the list link
+typedef struct PoolBlock {
+    struct PoolBlock *next;
+} PoolBlock_t;
+
+typedef struct {
+    PoolBlock_t *blocks[POOL_CACHE_SIZE];
+    int count;
+} PoolCache_t;
+
+typedef struct {
+    const char *name;
+    uint8_t *storage;
+    size_t block_size;
+    size_t block_count;
+    uint8_t *in_use;         // One flag per block (double-free detection)
+
+    PoolBlock_t *free_list;  // Shared list (needs a lock on a real SMP system)
+    size_t free_count;       // Blocks on the shared list
+    size_t min_free;         // Low-water mark of free blocks (all levels)
+    size_t used_count;
+    size_t lock_trips;       // How often we had to take the shared list "lock"
+    size_t errors;
+
+#if POOL_USE_CORE_CACHE
+    PoolCache_t cache[POOL_NUM_CORES];
+#endif
+} MemPool_t;
+
+/*
+ * Typed pool: declares the storage and type-safe wrappers.
+ * The union guarantees every block can hold the free-list link
+ * and is aligned for both the object and the pointer.
+ */
+#define POOL_DEFINE(pool, type, count)                                              \
+    static union { type item; PoolBlock_t link; } pool##_storage[count];            \
+    static uint8_t pool##_in_use[count];                                            \
+    static MemPool_t pool = { .name = #pool, .storage = (uint8_t *)pool##_storage,  \
+                              .block_size = sizeof(pool##_storage[0]),              \
+                              .block_count = count, .in_use = pool##_in_use };      \
+    static inline type *pool##_alloc(int core) { return (type *)pool_alloc(&pool, core); } \
+    static inline void pool##_free(type *obj, int core) { pool_free(&pool, obj, core); }
+
+static inline size_t pool_index(MemPool_t *pool, void *block) {
+    return (size_t)((uint8_t *)block - pool->storage) / pool->block_size;
+}
+
+void pool_init(MemPool_t *pool) {
+    pool->free_list = NULL;
+    // Push in reverse so the first alloc returns block 0 (nicer to read)
+    for (size_t i = pool->block_count; i-- > 0; ) {
+        PoolBlock_t *block = (PoolBlock_t *)(pool->storage + i * pool->block_size);
+#if POOL_DEBUG_POISON
+        memset(block, POISON_FREE, pool->block_size);
+#endif
+        block->next = pool->free_list;
+        pool->free_list = block;
+    }
+    memset(pool->in_use, 0, pool->block_count);
+    pool->free_count = pool->block_count;
+    pool->min_free = pool->block_count;
+    pool->used_count = 0;
+    pool->lock_trips = 0;
+    pool->errors = 0;
+#if POOL_USE_CORE_CACHE
+    memset(pool->cache, 0, sizeof(pool->cache));
+#endif
+}
+
+// --- Shared free list (the only part that would need a lock) ---
+
+static PoolBlock_t *pool_pop_shared(MemPool_t *pool) {
+    PoolBlock_t *block = pool->free_list;
+    if (block != NULL) {
+        pool->free_list = block->next;
+        pool->free_count--;
+    }
+    return block;
+}
+
+static void pool_push_shared(MemPool_t *pool, PoolBlock_t *block) {
+    block->next = pool->free_list;
+    pool->free_list = block;
+    pool->free_count++;
+}
+
+#if POOL_DEBUG_POISON
+// Everything after the link word must still hold the free pattern
+static bool pool_poison_intact(MemPool_t *pool, PoolBlock_t *block) {
+    uint8_t *bytes = (uint8_t *)block;
+    for (size_t i = sizeof(PoolBlock_t); i < pool->block_size; i++) {
+        if (bytes[i] != POISON_FREE) return false;
+    }
+    return true;
+}
+#endif
+
+static bool pool_core_valid(MemPool_t *pool, int core) {
+    if (core >= 0 && core < POOL_NUM_CORES) return true;
+    printf("[Pool %s] ERROR: Invalid core %d!\n", pool->name, core);
+    pool->errors++;
+    return false;
+}
+
+#if POOL_USE_CORE_CACHE
+// Last resort before "exhausted": blocks parked in another core's cache are
+// still free. (On real SMP this takes that core's cache lock.)
+static PoolBlock_t *pool_steal_from_caches(MemPool_t *pool, int core) {
+    for (int other = 0; other < POOL_NUM_CORES; other++) {
+        PoolCache_t *victim = &pool->cache[other];
+        if (other == core || victim->count == 0) continue;
+        pool->lock_trips++;
+        return victim->blocks[--victim->count];
+    }
+    return NULL;
+}
+#endif
+
+void *pool_alloc(MemPool_t *pool, int core) {
+    PoolBlock_t *block = NULL;
+    if (!pool_core_valid(pool, core)) return NULL;
+
+#if POOL_USE_CORE_CACHE
+    PoolCache_t *cache = &pool->cache[core];
+    if (cache->count == 0) {
+        // Refill a batch in ONE trip to the shared list
+        pool->lock_trips++;
+        while (cache->count < POOL_CACHE_BATCH) {
+            PoolBlock_t *b = pool_pop_shared(pool);
+            if (b == NULL) break;
+            cache->blocks[cache->count++] = b;
+        }
+    }
+    if (cache->count > 0) {
+        block = cache->blocks[--cache->count];
+    } else {
+        block = pool_steal_from_caches(pool, core);
+    }
+#else
+    (void)core;
+    pool->lock_trips++;
+    block = pool_pop_shared(pool);
+#endif
+
+    if (block == NULL) {
+        printf("[Pool %s] EXHAUSTED! (%zu blocks in use)\n", pool->name, pool->used_count);
+        return NULL;
+    }
+
+#if POOL_DEBUG_POISON
+    if (!pool_poison_intact(pool, block)) {
+        printf("[Pool %s] CORRUPTION: block %zu was written after free!\n",
+               pool->name, pool_index(pool, block));
+        pool->errors++;
+    }
+    memset(block, POISON_ALLOC, pool->block_size);
+#endif
+
+    pool->in_use[pool_index(pool, block)] = 1;
+    pool->used_count++;
+    size_t free_now = pool->block_count - pool->used_count;
+    if (free_now < pool->min_free) pool->min_free = free_now;
+    return block;
+}
+
+void pool_free(MemPool_t *pool, void *obj, int core) {
+    if (obj == NULL || !pool_core_valid(pool, core)) return;
+
+    uint8_t *p = (uint8_t *)obj;
+    size_t offset = (size_t)(p - pool->storage);
+    if (p < pool->storage || offset >= pool->block_size * pool->block_count ||
+        offset % pool->block_size != 0) {
+        printf("[Pool %s] ERROR: %p does not belong to this pool!\n", pool->name, obj);
+        pool->errors++;
+        return;
+    }
+
+    size_t index = offset / pool->block_size;
+    if (!pool->in_use[index]) {
+        printf("[Pool %s] ERROR: Double free of block %zu!\n", pool->name, index);
+        pool->errors++;
+        return;
+    }
+    pool->in_use[index] = 0;
+    pool->used_count--;
+
+    PoolBlock_t *block = (PoolBlock_t *)obj;
+#if POOL_DEBUG_POISON
+    memset(block, POISON_FREE, pool->block_size);
+#endif
+
+#if POOL_USE_CORE_CACHE
+    PoolCache_t *cache = &pool->cache[core];
+    if (cache->count == POOL_CACHE_SIZE) {
+        // Cache full: hand a batch back in ONE trip
+        pool->lock_trips++;
+        for (int i = 0; i < POOL_CACHE_BATCH; i++) {
+            pool_push_shared(pool, cache->blocks[--cache->count]);
+        }
+    }
+    cache->blocks[cache->count++] = block;
+#else
+    (void)core;
+    pool->lock_trips++;
+    pool_push_shared(pool, block);
+#endif
+}
+
+void print_pool_stats(MemPool_t *pool) {
+    printf("[Pool %s] Block: %zu bytes x %zu, Used: %zu, Free (shared list): %zu, "
+           "Low-Water Mark: %zu, Lock Trips: %zu, Errors: %zu\n",
+           pool->name, pool->block_size, pool->block_count, pool->used_count,
+           pool->free_count, pool->min_free, pool->lock_trips, pool->errors);
+}
+
+// --- Kernel objects (same shapes as tcb_scheduler.c, ipc_queue_sim.c, software_timers.c) ---
+
+#define STACK_SIZE 128
+typedef uint32_t StackType_t;
+
+typedef struct TCB {
+    volatile StackType_t *pxTopOfStack;
+    char pcTaskName[16];
+    int uxPriority;
+    StackType_t pxStack[STACK_SIZE];
+} TCB_t;
+
+typedef struct {
+    int id;
+    char text[10];
+} Message_t;
+
+typedef struct {
+    const char *name;
+    int period_ticks;
+    int remaining_ticks;
+    bool is_active;
+    void (*callback)(const char *);
+} SoftwareTimer_t;
+
+#define MAX_TASKS    2000
+#define MAX_MESSAGES 64
+#define MAX_TIMERS   4096
+
+POOL_DEFINE(tcb_pool, TCB_t, MAX_TASKS)
+POOL_DEFINE(msg_pool, Message_t, MAX_MESSAGES)
+POOL_DEFINE(timer_pool, SoftwareTimer_t, MAX_TIMERS)
+
+// Task creation now comes from the pool instead of a fixed global array
+TCB_t *CreateTask(const char *name, int priority, int core) {
+    TCB_t *tcb = tcb_pool_alloc(core);
+    if (tcb == NULL) return NULL;
+    snprintf(tcb->pcTaskName, sizeof(tcb->pcTaskName), "%s", name);
+    tcb->uxPriority = priority;
+    tcb->pxTopOfStack = &(tcb->pxStack[STACK_SIZE - 1]);
+    return tcb;
+}
+
+int main() {
+    printf("=== Fixed-Size Block Pools ===\n");
+    pool_init(&tcb_pool);
+    pool_init(&msg_pool);
+    pool_init(&timer_pool);
+
+    // 1. Thousands of tasks, no heap search, no fragmentation
+    printf("\n1. Creating %d tasks from the TCB pool...\n", MAX_TASKS);
+    static TCB_t *tasks[MAX_TASKS];
+    for (int i = 0; i < MAX_TASKS; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "Task%d", i);
+        tasks[i] = CreateTask(name, i % 8, i % POOL_NUM_CORES);
+    }
+    print_pool_stats(&tcb_pool);
+
+    printf("Pool is full. One more task:\n");
+    CreateTask("OneTooMany", 1, 0);
+
+    // Delete every other task, then create them again: same blocks get reused
+    for (int i = 0; i < MAX_TASKS; i += 2) tcb_pool_free(tasks[i], i % POOL_NUM_CORES);
+    for (int i = 0; i < MAX_TASKS; i += 2) tasks[i] = CreateTask("Again", 1, i % POOL_NUM_CORES);
+    print_pool_stats(&tcb_pool);
+    for (int i = 0; i < MAX_TASKS; i++) tcb_pool_free(tasks[i], i % POOL_NUM_CORES);
+
+    // 2. Queue items: alloc/free churn stays on the per-core cache
+    printf("\n2. 10000 message alloc/free pairs on core 0...\n");
+    for (int i = 0; i < 10000; i++) {
+        Message_t *msg = msg_pool_alloc(0);
+        msg->id = i;
+        strcpy(msg->text, "Ping");
+        msg_pool_free(msg, 0);
+    }
+    print_pool_stats(&msg_pool);
+#if POOL_USE_CORE_CACHE
+    printf("-> Only %zu trip(s) to the shared list for 20000 operations.\n", msg_pool.lock_trips);
+#endif
+
+    // Blocks parked in ANOTHER core's cache are still free: no false "exhausted"
+    printf("\n2b. Pool full; core 1 frees %d messages, core 0 allocates them again...\n", MAX_MESSAGES / 2);
+    static Message_t *msgs[MAX_MESSAGES];
+    int got = 0;
+    for (int i = 0; i < MAX_MESSAGES; i++) msgs[i] = msg_pool_alloc(0);
+    for (int i = 0; i < MAX_MESSAGES / 2; i++) msg_pool_free(msgs[i], 1);
+    for (int i = 0; i < MAX_MESSAGES / 2; i++) got += (msgs[i] = msg_pool_alloc(0)) != NULL;
+    printf("-> Got %d of %d back.\n", got, MAX_MESSAGES / 2);
+    print_pool_stats(&msg_pool);
+    for (int i = 0; i < MAX_MESSAGES; i++) msg_pool_free(msgs[i], 0);
+    msg_pool_alloc(POOL_NUM_CORES); // BUG: no such core -> rejected
+
+    // 3. Timers
+    printf("\n3. Creating %d timers...\n", MAX_TIMERS);
+    static SoftwareTimer_t *timers[MAX_TIMERS];
+    for (int i = 0; i < MAX_TIMERS; i++) {
+        timers[i] = timer_pool_alloc(1);
+        timers[i]->name = "ProtocolTimeout";
+        timers[i]->period_ticks = 100 + i;
+    }
+    print_pool_stats(&timer_pool);
+    for (int i = 0; i < MAX_TIMERS; i++) timer_pool_free(timers[i], 1);
+
+#if POOL_DEBUG_POISON
+    // 4. Bugs the debug mode catches
+    printf("\n4. Debug Poisoning...\n");
+    pool_init(&msg_pool);
+    Message_t *stale = msg_pool_alloc(0);
+    msg_pool_free(stale, 0);
+    strcpy(stale->text, "Stale!"); // BUG: use-after-free
+    msg_pool_alloc(0);             // Gets the same block back -> detected
+    msg_pool_free(stale, 0);       // Fine (it was re-allocated)
+    msg_pool_free(stale, 0);       // BUG: double free -> detected
+    print_pool_stats(&msg_pool);
+#endif
+
+    return 0;
+}
@@ -1,29 +1,53 @@
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
+#include <time.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /*
  * Phase 4 Missing Topics:
- * 1. Stack Overflow Detection (The Canary Method)
+ * 1. Stack Overflow Detection (Guard Band + High-Water Mark)
  * 2. Event Groups (Bitwise Flags)
  */
 
 // --- Topic 1: Stack Overflow Detection ---
-#define STACK_SIZE 10
-#define CANARY_VALUE 0xDEADBEEF
+// Every stack is painted with a fill byte when the task is created. Two
+// cheap services then read that paint back:
+//  - Guard band: the lowest STACK_GUARD_WORDS words must still be paint.
+//    Checked on EVERY context switch, so it has to cost a few instructions:
+//    fixed length, no early exit, XOR/OR the words together.
+//  - High-water mark: how many words at the bottom were NEVER touched. A scan
+//    from the bottom up, 64 bytes per step with SSE2 (8 bytes without). Run
+//    it from a low-priority task or a debug shell, not on the switch path.
+// The mark is a lower bound on usage: a pushed value that happens to equal
+// the paint looks untouched. With 0xA5 that is rare enough to ignore.
+#define STACK_SIZE        16
+#define STACK_FILL_BYTE   0xA5
+#define CANARY_VALUE      0xA5A5A5A5u  // Fill byte repeated across a word
+#define STACK_GUARD_WORDS 4            // Guard band at the far end of every stack
 
 typedef struct {
-    uint32_t stack[STACK_SIZE];
-    int top;
+    const char *name;
+    uint32_t *stack;    // Lowest address; the stack grows down towards it
+    size_t size;        // In words
+    size_t top;         // Next push goes to stack[top - 1]
+    unsigned overflows; // Times the guard band was found damaged
 } TaskStack_t;
 
-void init_stack(TaskStack_t *t) {
-    // Fill the stack with a known pattern ("Painting the Stack")
-    for(int i=0; i<STACK_SIZE; i++) {
-        t->stack[i] = CANARY_VALUE;
-    }
-    t->top = STACK_SIZE; // Stack grows down
+void init_stack(TaskStack_t *t, const char *name, uint32_t *buffer, size_t words) {
+    // Fill the stack with a known pattern ("Painting the Stack"). The fill is
+    // the same byte everywhere, so memset can paint it at full speed.
+    memset(buffer, STACK_FILL_BYTE, words * sizeof(uint32_t));
+    t->name = name;
+    t->stack = buffer;
+    t->size = words;
+    t->top = words; // Stack grows down
+    t->overflows = 0;
 }
 
 // Simulate pushing data (Function calls)
@@ -38,74 +62,430 @@ void stack_push(TaskStack_t *t, uint32_t val) {
     }
 }
 
-// Check if the stack has overflowed (FreeRTOS Method 2)
-bool check_overflow(TaskStack_t *t) {
-    // Check the LAST word of the stack (index 0 in our array, since it grows down to 0)
-    // If it's no longer the Canary value, we overflowed (or got very close).
-    if (t->stack[0] != CANARY_VALUE) {
-        return true; // Overflow detected!
+// Returning from functions: SP moves up, the data (and the damage) stays
+void stack_pop(TaskStack_t *t, size_t words) {
+    t->top = (t->top + words > t->size) ? t->size : t->top + words;
+}
+
+// Check if the stack has overflowed (FreeRTOS Methods 1 + 2)
+bool check_overflow(const TaskStack_t *t) {
+    // Method 1: SP is inside the guard band right now.
+    // Method 2: something wrote into the guard band since the last switch,
+    // even if SP has moved back up already.
+    uint32_t diff = 0;
+    for (int i = 0; i < STACK_GUARD_WORDS; i++) {
+        diff |= t->stack[i] ^ CANARY_VALUE;
+    }
+    return (t->top < STACK_GUARD_WORDS) | (diff != 0);
+}
+
+void vApplicationStackOverflowHook(TaskStack_t *t) {
+    t->overflows++;
+    printf("[HOOK] Stack overflow in %s (SP at word %zu, guard band damaged)\n", t->name, t->top);
+}
+
+// Called by the scheduler for the task being switched OUT
+void taskCHECK_FOR_STACK_OVERFLOW(TaskStack_t *t) {
+    if (check_overflow(t)) vApplicationStackOverflowHook(t);
+}
+
+// Reference scan: one byte at a time, like FreeRTOS prvTaskCheckFreeStackSpace
+size_t uxTaskGetStackHighWaterMarkBytewise(const TaskStack_t *t) {
+    const uint8_t *p = (const uint8_t *)t->stack;
+    size_t n = t->size * sizeof(uint32_t), i = 0;
+    while (i < n && p[i] == STACK_FILL_BYTE) i++;
+    return i / sizeof(uint32_t);
+}
+
+// Count painted bytes from the bottom, as wide as the CPU allows
+static size_t count_painted_bytes(const uint8_t *p, size_t n) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i fill = _mm_set1_epi8((char)STACK_FILL_BYTE);
+    // 64 bytes per step: AND four compares, one movemask, one branch
+    for (; i + 64 <= n; i += 64) {
+        __m128i c0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), fill);
+        __m128i c1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i + 16)), fill);
+        __m128i c2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i + 32)), fill);
+        __m128i c3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i + 48)), fill);
+        __m128i all = _mm_and_si128(_mm_and_si128(c0, c1), _mm_and_si128(c2, c3));
+        if (_mm_movemask_epi8(all) != 0xFFFF) break;
+    }
+    for (; i + 16 <= n; i += 16) {
+        __m128i c = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), fill);
+        unsigned mask = (unsigned)_mm_movemask_epi8(c);
+        if (mask != 0xFFFF) return i + (size_t)__builtin_ctz(~mask);
+    }
+#endif
+    const uint64_t fill64 = 0x0101010101010101ull * STACK_FILL_BYTE;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, sizeof(w));
+        if (w != fill64) break;
+    }
+    while (i < n && p[i] == STACK_FILL_BYTE) i++;
+    return i;
+}
+
+// Minimum free space ever seen, in words (guard band included, as in FreeRTOS)
+size_t uxTaskGetStackHighWaterMark(const TaskStack_t *t) {
+    return count_painted_bytes((const uint8_t *)t->stack, t->size * sizeof(uint32_t)) / sizeof(uint32_t);
+}
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Simple LCG so every run sizes the same fleet
+static uint32_t rng_state = 12345;
+static uint32_t rng() {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+// A task runs for a while: calls nest up to `depth` words deep, then return
+static void simulate_task_run(TaskStack_t *t, size_t depth) {
+    size_t start = t->top;
+    for (size_t i = 0; i < depth; i++) stack_push(t, 0x1000u + (uint32_t)i);
+    stack_pop(t, t->top < start ? start - t->top : 0);
+}
+
+// Right-size a fleet of tasks from measured watermarks instead of guesses
+#define FLEET_TASKS     2000
+#define FLEET_STACK     512   // Words (2 KB) given to every task up front
+#define FLEET_SWITCHES  20    // Runs per task before we measure
+#define FLEET_MARGIN    25    // Percent headroom on top of the measured peak
+
+static void run_fleet_sizing() {
+    uint32_t *arena = malloc((size_t)FLEET_TASKS * FLEET_STACK * sizeof(uint32_t));
+    TaskStack_t *tasks = malloc(FLEET_TASKS * sizeof(TaskStack_t));
+    if (!arena || !tasks) {
+        printf("Out of memory\n");
+        free(arena);
+        free(tasks);
+        return;
+    }
+
+    for (int i = 0; i < FLEET_TASKS; i++) {
+        init_stack(&tasks[i], "Worker", arena + (size_t)i * FLEET_STACK, FLEET_STACK);
+    }
+
+    // Each task has its own typical depth (most are small, a few are deep),
+    // and each run goes somewhere between half and all of it.
+    uint64_t switches = 0;
+    for (int round = 0; round < FLEET_SWITCHES; round++) {
+        for (int i = 0; i < FLEET_TASKS; i++) {
+            size_t typical = 24 + (size_t)(i * 7919 % 97) * ((i % 50 == 0) ? 4 : 1);
+            size_t depth = typical / 2 + rng() % (typical / 2 + 1);
+            simulate_task_run(&tasks[i], depth);
+
+            taskCHECK_FOR_STACK_OVERFLOW(&tasks[i]); // Switch out
+            switches++;
+        }
+    }
+
+    // Time the switch-path check on its own (a clock read costs more than it)
+    volatile size_t sink = 0;
+    uint64_t t0 = now_ns();
+    for (int round = 0; round < FLEET_SWITCHES; round++) {
+        for (int i = 0; i < FLEET_TASKS; i++) sink += check_overflow(&tasks[i]);
     }
-    return false;
+    uint64_t check_ns = now_ns() - t0;
+
+    // Scan every stack both ways; they must agree, the wide one must be faster
+    t0 = now_ns();
+    for (int i = 0; i < FLEET_TASKS; i++) sink += uxTaskGetStackHighWaterMarkBytewise(&tasks[i]);
+    uint64_t byte_ns = now_ns() - t0;
+    t0 = now_ns();
+    for (int i = 0; i < FLEET_TASKS; i++) sink += uxTaskGetStackHighWaterMark(&tasks[i]);
+    uint64_t wide_ns = now_ns() - t0;
+    (void)sink;
+
+    size_t before = 0, after = 0, max_used = 0;
+    bool agree = true;
+    for (int i = 0; i < FLEET_TASKS; i++) {
+        size_t hwm = uxTaskGetStackHighWaterMark(&tasks[i]);
+        agree &= (hwm == uxTaskGetStackHighWaterMarkBytewise(&tasks[i]));
+        size_t used = tasks[i].size - hwm;
+        size_t fit = used + used * FLEET_MARGIN / 100 + STACK_GUARD_WORDS;
+        fit = (fit + 7) & ~(size_t)7; // Round up to 32 bytes
+        if (used > max_used) max_used = used;
+        before += tasks[i].size;
+        after += fit;
+    }
+
+    printf("%d tasks x %d words, %llu switches, guard check %.1f ns/switch\n",
+           FLEET_TASKS, FLEET_STACK, (unsigned long long)switches, (double)check_ns / (double)switches);
+    printf("Watermark scan: bytewise %.1f us, %s %.1f us (results %s)\n",
+           byte_ns / 1000.0,
+#ifdef __SSE2__
+           "SSE2",
+#else
+           "64-bit",
+#endif
+           wide_ns / 1000.0, agree ? "match" : "DIFFER");
+    printf("Deepest task used %zu words. Stack RAM: %zu KB as guessed -> %zu KB measured + %d%%\n",
+           max_used, before * sizeof(uint32_t) / 1024, after * sizeof(uint32_t) / 1024, FLEET_MARGIN);
+
+    free(tasks);
+    free(arena);
 }
 
 // --- Topic 2: Event Groups ---
 // Scenario: Task waits for WiFi (Bit 0) AND Bluetooth (Bit 1) to be ready.
+//
+// An event group is a set of bits plus a list of BLOCKED tasks. Each waiter
+// says which bits it wants, ANY or ALL of them, and whether to clear them when
+// it wakes. Setting bits walks the wait list ONCE and wakes everybody whose
+// condition is now true; nobody polls. Bits asked to be cleared on exit are
+// cleared AFTER the walk, so every waiter sees the same value.
 #define BIT_WIFI  (1 << 0) // 0x01
 #define BIT_BLE   (1 << 1) // 0x02
 
-uint32_t event_group = 0;
+// Rendezvous: one bit per task taking part
+#define SYNC_TASK_0 (1 << 8)
+#define SYNC_TASK_1 (1 << 9)
+#define SYNC_TASK_2 (1 << 10)
+#define SYNC_ALL    (SYNC_TASK_0 | SYNC_TASK_1 | SYNC_TASK_2)
+
+typedef uint32_t EventBits_t;
+typedef uint32_t TickType_t;
+#define portMAX_DELAY 0xFFFFFFFFu
 
-void set_event_bit(uint32_t bit) {
-    event_group |= bit; // OR operation to set bit
-    printf("[EventGroup] Bit set. Current Value: 0x%X\n", event_group);
+// Simulated TCB
+typedef struct TCB {
+    const char *name;
+    bool is_blocked;
+    EventBits_t wait_bits;        // Bits this task is waiting for
+    bool wait_for_all;            // true = ALL bits, false = ANY bit
+    bool clear_on_exit;           // Clear wait_bits when the wait succeeds
+    TickType_t wake_tick;         // Timeout tick (may wrap)
+    bool wait_forever;            // portMAX_DELAY: no timeout at all
+    EventBits_t result_bits;      // Event bits at the moment the task woke
+    bool timed_out;
+    struct TCB *wait_next;        // Link in the event group wait list
+    struct TCB *wait_prev;
+} TCB_t;
+
+typedef struct {
+    EventBits_t bits;
+    TCB_t *head;                  // Waiters, FIFO
+    TCB_t *tail;
+} EventGroup_t;
+
+static TickType_t current_tick = 0;
+
+void xEventGroupInit(EventGroup_t *eg) {
+    memset(eg, 0, sizeof(*eg));
 }
 
-void wait_for_all_events() {
-    uint32_t target = BIT_WIFI | BIT_BLE; // 0x03
-    
-    printf("[Task] Waiting for WiFi (0x1) AND BLE (0x2)...\n");
-    
-    if ((event_group & target) == target) {
-        printf("[Task] SUCCESS! Both events happened.\n");
-    } else {
-        printf("[Task] Still waiting... (Current: 0x%X)\n", event_group);
+EventBits_t xEventGroupGetBits(EventGroup_t *eg) {
+    return eg->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroup_t *eg, EventBits_t bits) {
+    EventBits_t old = eg->bits;
+    eg->bits &= ~bits;            // AND-NOT to clear bits
+    return old;
+}
+
+static bool wait_condition_met(EventBits_t current, EventBits_t wanted, bool wait_for_all) {
+    return wait_for_all ? ((current & wanted) == wanted) : ((current & wanted) != 0);
+}
+
+static void waitlist_add(EventGroup_t *eg, TCB_t *task) {
+    task->wait_next = NULL;
+    task->wait_prev = eg->tail;
+    if (eg->tail != NULL) eg->tail->wait_next = task;
+    else eg->head = task;
+    eg->tail = task;
+}
+
+static void waitlist_remove(EventGroup_t *eg, TCB_t *task) {
+    if (task->wait_prev != NULL) task->wait_prev->wait_next = task->wait_next;
+    else eg->head = task->wait_next;
+    if (task->wait_next != NULL) task->wait_next->wait_prev = task->wait_prev;
+    else eg->tail = task->wait_prev;
+    task->wait_next = NULL;
+    task->wait_prev = NULL;
+}
+
+static void wake_task(EventGroup_t *eg, TCB_t *task, EventBits_t result, bool timed_out) {
+    waitlist_remove(eg, task);
+    task->is_blocked = false;
+    task->result_bits = result;
+    task->timed_out = timed_out;
+    printf("[OS] Task '%s' UNBLOCKED (%s, bits 0x%X).\n", task->name,
+           timed_out ? "TIMEOUT" : "condition met", result);
+}
+
+// Returns the event bits. If the wait is satisfied now, the task does not block.
+// If it blocks, the result arrives later in task->result_bits / task->timed_out.
+EventBits_t xEventGroupWaitBits(EventGroup_t *eg, EventBits_t bits_to_wait_for, bool clear_on_exit,
+                                bool wait_for_all, TickType_t ticks_to_wait, TCB_t *task) {
+    EventBits_t current = eg->bits;
+
+    if (wait_condition_met(current, bits_to_wait_for, wait_for_all)) {
+        if (clear_on_exit) eg->bits &= ~bits_to_wait_for;
+        task->result_bits = current;
+        task->timed_out = false;
+        printf("[EventGroup] '%s' wait for %s of 0x%X met immediately (bits 0x%X).\n",
+               task->name, wait_for_all ? "ALL" : "ANY", bits_to_wait_for, current);
+        return current;
+    }
+
+    if (ticks_to_wait == 0) {
+        task->result_bits = current;
+        task->timed_out = true;   // Poll only: caller checks the returned bits
+        return current;
+    }
+
+    task->wait_bits = bits_to_wait_for;
+    task->wait_for_all = wait_for_all;
+    task->clear_on_exit = clear_on_exit;
+    task->wait_forever = (ticks_to_wait == portMAX_DELAY);
+    task->wake_tick = current_tick + ticks_to_wait;
+    task->is_blocked = true;
+    waitlist_add(eg, task);
+    printf("[OS] Task '%s' BLOCKED waiting for %s of 0x%X (bits 0x%X).\n",
+           task->name, wait_for_all ? "ALL" : "ANY", bits_to_wait_for, current);
+    return current;
+}
+
+// OR the bits in, then wake every satisfied waiter in a single pass
+EventBits_t xEventGroupSetBits(EventGroup_t *eg, EventBits_t bits) {
+    eg->bits |= bits; // OR operation to set bits
+    printf("[EventGroup] Bits 0x%X set. Current Value: 0x%X\n", bits, eg->bits);
+
+    EventBits_t bits_to_clear = 0;
+    TCB_t *task = eg->head;
+    while (task != NULL) {
+        TCB_t *next = task->wait_next; // 'task' may be unlinked below
+        if (wait_condition_met(eg->bits, task->wait_bits, task->wait_for_all)) {
+            if (task->clear_on_exit) bits_to_clear |= task->wait_bits;
+            wake_task(eg, task, eg->bits, false);
+        }
+        task = next;
+    }
+
+    eg->bits &= ~bits_to_clear;    // Every waiter saw the same value
+    return eg->bits;
+}
+
+// Rendezvous: set my bit, then wait until ALL the bits in bits_to_wait_for are set.
+// The last task to arrive releases everyone; the bits are cleared for the next round.
+EventBits_t xEventGroupSync(EventGroup_t *eg, EventBits_t bits_to_set, EventBits_t bits_to_wait_for,
+                            TickType_t ticks_to_wait, TCB_t *task) {
+    EventBits_t original = eg->bits;
+    printf("[EventGroup] '%s' reached the sync point.\n", task->name);
+    xEventGroupSetBits(eg, bits_to_set); // May release the other tasks
+
+    EventBits_t result = original | bits_to_set;
+    if ((result & bits_to_wait_for) == bits_to_wait_for) {
+        eg->bits &= ~bits_to_wait_for;
+        task->result_bits = result;
+        task->timed_out = false;
+        printf("[EventGroup] '%s' was the last one: everybody released.\n", task->name);
+        return result;
+    }
+    return xEventGroupWaitBits(eg, bits_to_wait_for, true, true, ticks_to_wait, task);
+}
+
+// Tick interrupt: time out waiters whose block time expired
+void event_group_tick(EventGroup_t *eg) {
+    current_tick++;
+    TCB_t *task = eg->head;
+    while (task != NULL) {
+        TCB_t *next = task->wait_next;
+        // Wrap-safe: still right when the wait crosses the tick counter wrapping
+        if (!task->wait_forever && (int32_t)(current_tick - task->wake_tick) >= 0) {
+            wake_task(eg, task, eg->bits, true);
+        }
+        task = next;
     }
 }
 
 int main() {
-    printf("=== 1. Stack Overflow Detection (Canary) ===\n");
+    printf("=== 1. Stack Overflow Detection (Guard Band) ===\n");
+    uint32_t my_buffer[STACK_SIZE];
     TaskStack_t my_stack;
-    init_stack(&my_stack);
-    
+    init_stack(&my_stack, "MyTask", my_buffer, STACK_SIZE);
+
     // Push some values (Safe)
     stack_push(&my_stack, 1);
     stack_push(&my_stack, 2);
-    
+
     if (check_overflow(&my_stack)) printf("Overflow? YES\n");
-    else printf("Overflow? NO (Canary intact: 0x%X)\n", my_stack.stack[0]);
-    
-    // Push too many values (Unsafe)
+    else printf("Overflow? NO (Guard intact: 0x%X, high-water mark %zu words)\n",
+                my_stack.stack[0], uxTaskGetStackHighWaterMark(&my_stack));
+
+    // Push too many values (Unsafe): the last ones land in the guard band
     printf("Pushing until overflow...\n");
-    for(int i=0; i<10; i++) stack_push(&my_stack, i+10);
-    
-    // Simulate overwriting the bottom-most slot (The Canary)
-    // In real life, the stack pointer would go below 0.
-    // Here we manually corrupt the canary to simulate the effect.
-    my_stack.stack[0] = 0x12345678; 
-    
-    if (check_overflow(&my_stack)) printf("Overflow? YES (Canary died! Found: 0x%X)\n", my_stack.stack[0]);
+    for (int i = 0; i < STACK_SIZE - 2; i++) stack_push(&my_stack, i + 10);
+    stack_pop(&my_stack, STACK_SIZE); // Even after every call returned...
+
+    if (check_overflow(&my_stack)) printf("Overflow? YES (Guard died! Found: 0x%X)\n", my_stack.stack[0]);
+
+    printf("\n=== 1b. Guard Band Checked on Every Context Switch ===\n");
+    uint32_t buf_a[64], buf_b[64], buf_c[64];
+    TaskStack_t round_robin[3];
+    init_stack(&round_robin[0], "Sensor", buf_a, 64);
+    init_stack(&round_robin[1], "Parser", buf_b, 64);
+    init_stack(&round_robin[2], "Logger", buf_c, 64);
+    size_t depths[3] = { 20, 35, 59 }; // Logger recurses too deep once
+    for (int tick = 0; tick < 6; tick++) {
+        TaskStack_t *cur = &round_robin[tick % 3];
+        simulate_task_run(cur, depths[tick % 3] + (size_t)(tick / 3) * 3);
+        taskCHECK_FOR_STACK_OVERFLOW(cur); // Switch out
+    }
+    for (int i = 0; i < 3; i++) {
+        printf("%s: high-water mark %zu of %zu words free, %u overflow(s)\n", round_robin[i].name,
+               uxTaskGetStackHighWaterMark(&round_robin[i]), round_robin[i].size, round_robin[i].overflows);
+    }
+
+    printf("\n=== 1c. Right-Sizing Stacks From Watermarks ===\n");
+    run_fleet_sizing();
 
     printf("\n=== 2. Event Groups (Bitwise Logic) ===\n");
-    event_group = 0;
-    wait_for_all_events();
-    
+    EventGroup_t net_events;
+    xEventGroupInit(&net_events);
+    TCB_t net_task = { .name = "NetTask" };
+
+    // Wait for WiFi AND BLE, clear them on exit, block forever
+    xEventGroupWaitBits(&net_events, BIT_WIFI | BIT_BLE, true, true, portMAX_DELAY, &net_task);
+
     printf("-> WiFi connects...\n");
-    set_event_bit(BIT_WIFI);
-    wait_for_all_events();
-    
+    xEventGroupSetBits(&net_events, BIT_WIFI);  // Not enough: NetTask stays asleep
+
     printf("-> BLE connects...\n");
-    set_event_bit(BIT_BLE);
-    wait_for_all_events();
+    xEventGroupSetBits(&net_events, BIT_BLE);   // Now NetTask wakes, bits cleared
+    printf("NetTask woke with 0x%X, group is now 0x%X\n", net_task.result_bits, xEventGroupGetBits(&net_events));
+
+    printf("\n=== 3. Many Waiters, One Pass, Timeout ===\n");
+    TCB_t ui_task  = { .name = "UITask" };
+    TCB_t log_task = { .name = "LogTask" };
+    TCB_t ota_task = { .name = "OTATask" };
+    xEventGroupWaitBits(&net_events, BIT_WIFI | BIT_BLE, false, false, portMAX_DELAY, &ui_task); // ANY
+    xEventGroupWaitBits(&net_events, BIT_WIFI | BIT_BLE, true, true, portMAX_DELAY, &log_task);  // ALL + clear
+    xEventGroupWaitBits(&net_events, BIT_BLE, false, true, 3, &ota_task);                        // 3 ticks
+
+    for (int i = 0; i < 3; i++) event_group_tick(&net_events); // OTATask gives up
+    printf("OTATask timed out? %s\n", ota_task.timed_out ? "YES" : "NO");
+
+    xEventGroupSetBits(&net_events, BIT_WIFI | BIT_BLE); // UITask + LogTask in ONE pass
+    printf("Group after LogTask's clear-on-exit: 0x%X\n", xEventGroupGetBits(&net_events));
+
+    printf("\n=== 4. Task Rendezvous (xEventGroupSync) ===\n");
+    EventGroup_t barrier;
+    xEventGroupInit(&barrier);
+    TCB_t sensor = { .name = "Sensor" }, filter = { .name = "Filter" }, radio = { .name = "Radio" };
+
+    xEventGroupSync(&barrier, SYNC_TASK_0, SYNC_ALL, portMAX_DELAY, &sensor); // Blocks
+    xEventGroupSync(&barrier, SYNC_TASK_1, SYNC_ALL, portMAX_DELAY, &filter); // Blocks
+    xEventGroupSync(&barrier, SYNC_TASK_2, SYNC_ALL, portMAX_DELAY, &radio);  // Releases all three
+    printf("Barrier bits after the round: 0x%X (ready for the next one)\n", xEventGroupGetBits(&barrier));
 
     return 0;
 }
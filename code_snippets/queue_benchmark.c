@@ -0,0 +1,397 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/*
+ * Phase 5: Queue Stress Test (Real Threads)
+ *
+ * queue_internals.c shows HOW a queue works, but single-threaded printf
+ * can't tell us how FAST it is. Here the same algorithm runs on real pthreads:
+ * - Ring storage of 'length' items of 'item_size' bytes (copy in / copy out).
+ * - A mutex plays the role of taskENTER_CRITICAL().
+ * - xTasksWaitingToSend / xTasksWaitingToReceive are intrusive lists sorted
+ *   by priority (FIFO among equals), exactly as in queue_internals.c.
+ * - Direct hand-off: a send to a queue with a blocked receiver copies straight
+ *   into that receiver's buffer, and a receive that frees a slot moves the
+ *   highest-priority blocked sender's item into it. The woken thread finds its
+ *   work already done; nobody wakes up just to retry.
+ * - Each thread sleeps on its OWN condition variable, so a wake-up goes to
+ *   exactly the waiter the list picked (like unblocking one TCB).
+ * Priorities only decide wait-list order here; the host OS still schedules
+ * all threads alike. Even producers are "high" (2), odd ones "low" (1).
+ *
+ * Measured per configuration (item size x queue depth):
+ * - Throughput: messages per second.
+ * - Latency: time an item spends IN the queue, from the moment it gets a
+ *   slot (or a receiver) to queue_receive() returning it (p50 / p99 / p99.9).
+ *   The clock is read just BEFORE taking the lock, by the thread that places
+ *   the item, and written into the item under the lock. So time a producer
+ *   spent blocked on a full queue is not counted; that shows up in SendBlk
+ *   and in the mean blocked time per priority (HiBlk / LoBlk).
+ * - Contention: lock attempts that found the mutex taken, how often
+ *   senders/receivers had to block, and how many sends were handed off.
+ *
+ * Build: gcc -O2 -pthread queue_benchmark.c -o queue_benchmark
+ * Run:   ./queue_benchmark [producers] [consumers] [messages_per_producer]
+ */
+
+// One per thread: stands in for the TCB's event list item
+typedef struct Waiter {
+    int priority;              // Higher number = Higher priority
+    struct Waiter *wait_next;
+    struct Waiter *wait_prev;
+    void *wait_buffer;         // Sender: item to send. Receiver: where to put the item.
+    bool done;                 // Set (under the lock) by whoever completed our send/receive
+    pthread_cond_t wake;       // Only this thread ever waits on it
+} Waiter_t;
+
+// Intrusive wait list (sorted: highest priority first, FIFO among equals)
+typedef struct {
+    Waiter_t *head;
+    Waiter_t *tail;
+    int count;
+} List_t;
+
+typedef struct {
+    uint8_t *storage;
+    size_t item_size;
+    size_t length;
+    size_t read_index;
+    size_t write_index;
+    size_t count;
+
+    pthread_mutex_t lock;
+    List_t xTasksWaitingToSend;    // Blocked Writers
+    List_t xTasksWaitingToReceive; // Blocked Readers
+
+    bool stamp_items;          // Benchmark: write send_ns into each item as it is placed
+
+    // Contention counters (updated under the lock, except lock_contended)
+    uint64_t lock_contended;
+    uint64_t send_blocked;
+    uint64_t recv_blocked;
+    uint64_t handoffs;         // Sends copied straight into a blocked receiver
+} Queue_t;
+
+// Every item starts with this header; the rest is payload up to item_size
+typedef struct {
+    uint64_t send_ns;
+    uint64_t seq;       // UINT64_MAX = "stop" message
+} ItemHeader_t;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void waiter_init(Waiter_t *w, int priority) {
+    memset(w, 0, sizeof(*w));
+    w->priority = priority;
+    pthread_cond_init(&w->wake, NULL);
+}
+
+void waiter_destroy(Waiter_t *w) {
+    pthread_cond_destroy(&w->wake);
+}
+
+// Insert by priority (like vListInsert). The walk is only over BLOCKED threads.
+static void list_add(List_t *list, Waiter_t *w, void *buffer) {
+    Waiter_t *after = list->tail;
+    while (after != NULL && after->priority < w->priority) {
+        after = after->wait_prev;
+    }
+
+    w->wait_prev = after;
+    w->wait_next = (after != NULL) ? after->wait_next : list->head;
+    if (w->wait_next != NULL) w->wait_next->wait_prev = w;
+    else list->tail = w;
+    if (after != NULL) after->wait_next = w;
+    else list->head = w;
+
+    list->count++;
+    w->wait_buffer = buffer;
+    w->done = false;
+}
+
+// Highest-priority waiter is always the head: O(1)
+static Waiter_t *list_remove_first(List_t *list) {
+    Waiter_t *w = list->head;
+    list->head = w->wait_next;
+    if (list->head != NULL) list->head->wait_prev = NULL;
+    else list->tail = NULL;
+    w->wait_next = NULL;
+    list->count--;
+    return w;
+}
+
+void queue_init(Queue_t *q, size_t length, size_t item_size) {
+    memset(q, 0, sizeof(*q));
+    q->storage = malloc(length * item_size);
+    q->length = length;
+    q->item_size = item_size;
+    pthread_mutex_init(&q->lock, NULL);
+}
+
+void queue_destroy(Queue_t *q) {
+    pthread_mutex_destroy(&q->lock);
+    free(q->storage);
+}
+
+// Count how often the lock was already held (the cost we want to see)
+static void queue_lock(Queue_t *q) {
+    if (pthread_mutex_trylock(&q->lock) != 0) {
+        __atomic_fetch_add(&q->lock_contended, 1, __ATOMIC_RELAXED);
+        pthread_mutex_lock(&q->lock);
+    }
+}
+
+// Returns the slot the item went into
+static uint8_t *ring_push(Queue_t *q, const void *item) {
+    uint8_t *slot = q->storage + q->write_index * q->item_size;
+    memcpy(slot, item, q->item_size);
+    if (++q->write_index == q->length) q->write_index = 0;
+    q->count++;
+    return slot;
+}
+
+static void ring_pop(Queue_t *q, void *item) {
+    memcpy(item, q->storage + q->read_index * q->item_size, q->item_size);
+    if (++q->read_index == q->length) q->read_index = 0;
+    q->count--;
+}
+
+// The item's time in the queue starts now ('t' was read before the lock)
+static void stamp(Queue_t *q, uint8_t *item, uint64_t t) {
+    if (q->stamp_items) memcpy(item + offsetof(ItemHeader_t, send_ns), &t, sizeof(t));
+}
+
+// Wake exactly this waiter; its send/receive has already been done for it
+static void wake_waiter(Waiter_t *w) {
+    w->done = true;
+    pthread_cond_signal(&w->wake);
+}
+
+// Returns true if the caller had to block (the queue was full)
+bool queue_send(Queue_t *q, const void *item, Waiter_t *self) {
+    uint64_t t = q->stamp_items ? now_ns() : 0; // Outside the lock: keeps the hold time short
+    queue_lock(q);
+
+    // A receiver is waiting (queue must be empty): hand the item over directly
+    if (q->xTasksWaitingToReceive.count > 0) {
+        Waiter_t *reader = list_remove_first(&q->xTasksWaitingToReceive);
+        memcpy(reader->wait_buffer, item, q->item_size);
+        stamp(q, reader->wait_buffer, t);
+        q->handoffs++;
+        wake_waiter(reader);
+        pthread_mutex_unlock(&q->lock);
+        return false;
+    }
+
+    if (q->count < q->length) {
+        stamp(q, ring_push(q, item), t);
+        pthread_mutex_unlock(&q->lock);
+        return false;
+    }
+
+    // Full: block. The receiver that frees a slot moves our item into it.
+    q->send_blocked++;
+    list_add(&q->xTasksWaitingToSend, self, (void *)item);
+    while (!self->done) pthread_cond_wait(&self->wake, &q->lock);
+    pthread_mutex_unlock(&q->lock);
+    return true;
+}
+
+void queue_receive(Queue_t *q, void *buffer, Waiter_t *self) {
+    uint64_t t = q->stamp_items ? now_ns() : 0; // Stamps a blocked sender's item, if we complete one
+    queue_lock(q);
+
+    if (q->count > 0) {
+        ring_pop(q, buffer); // Real FIFO: oldest item first
+
+        // A slot just opened: complete the highest-priority blocked send for it
+        if (q->xTasksWaitingToSend.count > 0) {
+            Waiter_t *writer = list_remove_first(&q->xTasksWaitingToSend);
+            stamp(q, ring_push(q, writer->wait_buffer), t);
+            wake_waiter(writer);
+        }
+        pthread_mutex_unlock(&q->lock);
+        return;
+    }
+
+    // Empty: block until a sender copies an item straight into 'buffer'
+    q->recv_blocked++;
+    list_add(&q->xTasksWaitingToReceive, self, buffer);
+    while (!self->done) pthread_cond_wait(&self->wake, &q->lock);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// --- Benchmark threads ---
+
+typedef struct {
+    Queue_t *q;
+    Waiter_t waiter;
+    uint64_t messages;
+    uint64_t blocked_sends;  // Producers: sends that found the queue full
+    uint64_t blocked_ns;     // Producers: total time spent in those sends
+    uint64_t *latencies;   // Consumers: ONE array shared by all of them
+    _Atomic uint64_t *next_latency; // Consumers: next free entry in it
+    uint64_t capacity;     // Consumers: its size
+} Worker_t;
+
+static void *producer_thread(void *arg) {
+    Worker_t *w = arg;
+    uint8_t *item = calloc(1, w->q->item_size);
+    ItemHeader_t *hdr = (ItemHeader_t *)item;
+
+    for (uint64_t i = 0; i < w->messages; i++) {
+        hdr->seq = i;
+        uint64_t t0 = now_ns();
+        if (queue_send(w->q, item, &w->waiter)) { // The queue stamps send_ns once it has a slot
+            w->blocked_sends++;
+            w->blocked_ns += now_ns() - t0;
+        }
+    }
+    free(item);
+    return NULL;
+}
+
+static void *consumer_thread(void *arg) {
+    Worker_t *w = arg;
+    uint8_t *item = malloc(w->q->item_size);
+    ItemHeader_t hdr;
+
+    for (;;) {
+        queue_receive(w->q, item, &w->waiter);
+        uint64_t recv_ns = now_ns();
+        memcpy(&hdr, item, sizeof(hdr));
+        if (hdr.seq == UINT64_MAX) break;
+        uint64_t slot = atomic_fetch_add_explicit(w->next_latency, 1, memory_order_relaxed);
+        if (slot < w->capacity) w->latencies[slot] = recv_ns - hdr.send_ns;
+    }
+    free(item);
+    return NULL;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t percentile(const uint64_t *sorted, uint64_t n, double p) {
+    if (n == 0) return 0;
+    uint64_t idx = (uint64_t)(p * (double)(n - 1));
+    return sorted[idx];
+}
+
+void run_benchmark(size_t item_size, size_t depth, int producers, int consumers, uint64_t per_producer) {
+    Queue_t q;
+    queue_init(&q, depth, item_size);
+    q.stamp_items = true;
+
+    uint64_t total = per_producer * (uint64_t)producers;
+    pthread_t threads[producers + consumers];
+    Worker_t workers[producers + consumers];
+    memset(workers, 0, sizeof(workers));
+
+    // One array for everybody: memory is per message, not per consumer x message
+    uint64_t *all = malloc(total * sizeof(uint64_t));
+    _Atomic uint64_t next_latency = 0;
+    if (all == NULL) {
+        printf("Out of memory for %llu latencies\n", (unsigned long long)total);
+        queue_destroy(&q);
+        return;
+    }
+
+    for (int i = 0; i < consumers; i++) {
+        Worker_t *w = &workers[producers + i];
+        w->q = &q;
+        waiter_init(&w->waiter, 1);
+        w->latencies = all;
+        w->next_latency = &next_latency;
+        w->capacity = total;
+        pthread_create(&threads[producers + i], NULL, consumer_thread, w);
+    }
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < producers; i++) {
+        workers[i].q = &q;
+        waiter_init(&workers[i].waiter, (i % 2 == 0) ? 2 : 1); // Alternate high / low
+        workers[i].messages = per_producer;
+        pthread_create(&threads[i], NULL, producer_thread, &workers[i]);
+    }
+    for (int i = 0; i < producers; i++) pthread_join(threads[i], NULL);
+
+    // One "stop" item per consumer (after all real data, thanks to FIFO)
+    Waiter_t main_waiter;
+    waiter_init(&main_waiter, 1);
+    uint8_t *stop = calloc(1, item_size);
+    ((ItemHeader_t *)stop)->seq = UINT64_MAX;
+    for (int i = 0; i < consumers; i++) queue_send(&q, stop, &main_waiter);
+    for (int i = 0; i < consumers; i++) pthread_join(threads[producers + i], NULL);
+    uint64_t elapsed = now_ns() - start;
+    free(stop);
+    waiter_destroy(&main_waiter);
+
+    // Mean time a blocked send waited, per priority: the wait lists favour "high"
+    uint64_t blk_ns[2] = { 0, 0 }, blk_n[2] = { 0, 0 };
+    for (int i = 0; i < producers; i++) {
+        int hi = (workers[i].waiter.priority == 2);
+        blk_ns[hi] += workers[i].blocked_ns;
+        blk_n[hi] += workers[i].blocked_sends;
+    }
+    for (int i = 0; i < producers + consumers; i++) waiter_destroy(&workers[i].waiter);
+
+    uint64_t n = atomic_load(&next_latency);
+    if (n > total) n = total;
+    qsort(all, n, sizeof(uint64_t), compare_u64);
+
+    printf("%6zu %6zu %12.0f %9llu %9llu %9llu %10llu %9llu %9llu %9llu %9llu %9llu\n",
+           item_size, depth, (double)n * 1e9 / (double)elapsed,
+           (unsigned long long)percentile(all, n, 0.50),
+           (unsigned long long)percentile(all, n, 0.99),
+           (unsigned long long)percentile(all, n, 0.999),
+           (unsigned long long)q.lock_contended,
+           (unsigned long long)q.send_blocked,
+           (unsigned long long)q.recv_blocked,
+           (unsigned long long)q.handoffs,
+           (unsigned long long)(blk_n[1] ? blk_ns[1] / blk_n[1] : 0),
+           (unsigned long long)(blk_n[0] ? blk_ns[0] / blk_n[0] : 0));
+
+    free(all);
+    queue_destroy(&q);
+}
+
+int main(int argc, char **argv) {
+    int producers = (argc > 1) ? atoi(argv[1]) : 4;
+    int consumers = (argc > 2) ? atoi(argv[2]) : 4;
+    uint64_t per_producer = (argc > 3) ? strtoull(argv[3], NULL, 10) : 100000;
+    if (producers < 1 || consumers < 1 || per_producer == 0) {
+        printf("Usage: %s [producers>=1] [consumers>=1] [messages_per_producer>=1]\n", argv[0]);
+        return 1;
+    }
+
+    printf("=== Queue Stress Test: %d producers, %d consumers, %llu msgs each ===\n",
+           producers, consumers, (unsigned long long)per_producer);
+    printf("%6s %6s %12s %9s %9s %9s %10s %9s %9s %9s %9s %9s\n",
+           "Item", "Depth", "Msgs/sec", "p50 ns", "p99 ns", "p99.9 ns",
+           "LockBusy", "SendBlk", "RecvBlk", "Handoff", "HiBlk ns", "LoBlk ns");
+
+    size_t item_sizes[] = { sizeof(ItemHeader_t), 64, 256 };
+    size_t depths[] = { 8, 64, 1024 };
+
+    for (size_t i = 0; i < sizeof(item_sizes) / sizeof(item_sizes[0]); i++) {
+        for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+            run_benchmark(item_sizes[i], depths[d], producers, consumers, per_producer);
+        }
+    }
+
+    return 0;
+}
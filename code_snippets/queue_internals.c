@@ -1,111 +1,222 @@
 #include <stdio.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 
 /*
  * Phase 5: Queue Internals (Deep Dive)
- * 
+ *
  * What happens INSIDE the Queue when you block?
  * The Queue struct contains TWO Linked Lists:
  * 1. xTasksWaitingToSend: Tasks waiting for space to write.
  * 2. xTasksWaitingToReceive: Tasks waiting for data to read.
- * 
+ *
  * When you block, you are moved from the Ready List to one of these lists.
+ *
+ * How the engine works:
+ * - Storage is a ring buffer of 'length' items of 'item_size' bytes each
+ *   (items are COPIED in and out, like FreeRTOS).
+ * - Wait lists are intrusive: the link lives inside the TCB (no fixed arrays).
+ *   They are kept sorted by priority, so the task to wake is ALWAYS the head: O(1).
+ * - Direct hand-off:
+ *   - Sender finds a blocked Receiver -> item is copied straight into the
+ *     Receiver's buffer (never touches the ring).
+ *   - Receiver frees a slot and a Sender is blocked -> the Sender's pending
+ *     item is copied into that slot on its behalf. No "wake up and retry".
  */
 
 // Simulated TCB
-typedef struct {
+typedef struct TCB {
     int id;
     const char *name;
+    int priority;             // Higher number = Higher priority
     bool is_blocked;
+    // Event list item: links the task into ONE queue wait list
+    struct TCB *wait_next;
+    struct TCB *wait_prev;
+    void *wait_buffer;        // Sender: item to send. Receiver: where to put the item.
 } TCB_t;
 
-// Simulated List
+// Intrusive wait list (sorted: highest priority first, FIFO among equals)
 typedef struct {
-    TCB_t *tasks[5];
+    TCB_t *head;
+    TCB_t *tail;
     int count;
 } List_t;
 
 // Simulated Queue
 typedef struct {
-    int buffer[2]; // Small buffer (size 2)
-    int count;
-    int size;
+    uint8_t *storage;         // length * item_size bytes
+    size_t item_size;
+    size_t length;            // Capacity in items
+    size_t read_index;
+    size_t write_index;
+    size_t count;
     List_t xTasksWaitingToSend;    // Blocked Writers
     List_t xTasksWaitingToReceive; // Blocked Readers
 } Queue_t;
 
-void list_add(List_t *list, TCB_t *task) {
-    list->tasks[list->count++] = task;
+// Insert by priority (like vListInsert). The walk is only over BLOCKED tasks.
+void list_add(List_t *list, TCB_t *task, void *buffer) {
+    TCB_t *after = list->tail;
+    while (after != NULL && after->priority < task->priority) {
+        after = after->wait_prev;
+    }
+
+    task->wait_prev = after;
+    task->wait_next = (after != NULL) ? after->wait_next : list->head;
+    if (task->wait_next != NULL) task->wait_next->wait_prev = task;
+    else list->tail = task;
+    if (after != NULL) after->wait_next = task;
+    else list->head = task;
+
+    list->count++;
+    task->wait_buffer = buffer;
     task->is_blocked = true;
-    printf("[OS] Task '%s' BLOCKED and added to Queue Wait List.\n", task->name);
+    printf("[OS] Task '%s' (Prio %d) BLOCKED and added to Queue Wait List.\n", task->name, task->priority);
 }
 
-TCB_t* list_remove_first(List_t *list) {
-    if (list->count == 0) return NULL;
-    TCB_t *task = list->tasks[0];
-    // Shift remaining (Simplified)
-    for(int i=0; i<list->count-1; i++) list->tasks[i] = list->tasks[i+1];
-    list->count--;
+// Unlink any task in O(1) (e.g., its block time expired)
+void list_remove(List_t *list, TCB_t *task) {
+    if (task->wait_prev != NULL) task->wait_prev->wait_next = task->wait_next;
+    else list->head = task->wait_next;
+    if (task->wait_next != NULL) task->wait_next->wait_prev = task->wait_prev;
+    else list->tail = task->wait_prev;
+
+    task->wait_next = NULL;
+    task->wait_prev = NULL;
+    task->wait_buffer = NULL;
     task->is_blocked = false;
+    list->count--;
+}
+
+// Highest-priority waiter is always the head: O(1)
+TCB_t* list_remove_first(List_t *list) {
+    TCB_t *task = list->head;
+    if (task == NULL) return NULL;
+    list_remove(list, task);
     printf("[OS] Task '%s' UNBLOCKED (Moved to Ready List).\n", task->name);
     return task;
 }
 
-void queue_send(Queue_t *q, int data, TCB_t *task) {
-    if (q->count < q->size) {
-        q->buffer[q->count++] = data;
-        printf("[Queue] '%s' sent %d. (Count: %d/%d)\n", task->name, data, q->count, q->size);
-        
-        // Check if anyone was waiting to receive
-        if (q->xTasksWaitingToReceive.count > 0) {
-            list_remove_first(&q->xTasksWaitingToReceive);
-        }
-    } else {
-        printf("[Queue] FULL! '%s' wants to send.\n", task->name);
-        list_add(&q->xTasksWaitingToSend, task);
+void queue_init(Queue_t *q, void *storage, size_t length, size_t item_size) {
+    memset(q, 0, sizeof(*q));
+    q->storage = storage;
+    q->length = length;
+    q->item_size = item_size;
+}
+
+static void ring_push(Queue_t *q, const void *item) {
+    memcpy(q->storage + q->write_index * q->item_size, item, q->item_size);
+    if (++q->write_index == q->length) q->write_index = 0;
+    q->count++;
+}
+
+static void ring_pop(Queue_t *q, void *item) {
+    memcpy(item, q->storage + q->read_index * q->item_size, q->item_size);
+    if (++q->read_index == q->length) q->read_index = 0;
+    q->count--;
+}
+
+// Returns true if the item was delivered, false if 'task' is now blocked
+bool queue_send(Queue_t *q, const void *item, TCB_t *task) {
+    // A Receiver is waiting (queue must be empty): hand the item over directly
+    if (q->xTasksWaitingToReceive.count > 0) {
+        TCB_t *reader = q->xTasksWaitingToReceive.head;
+        memcpy(reader->wait_buffer, item, q->item_size);
+        printf("[Queue] '%s' handed item directly to '%s'.\n", task->name, reader->name);
+        list_remove_first(&q->xTasksWaitingToReceive);
+        return true;
     }
+
+    if (q->count < q->length) {
+        ring_push(q, item);
+        printf("[Queue] '%s' sent an item. (Count: %zu/%zu)\n", task->name, q->count, q->length);
+        return true;
+    }
+
+    printf("[Queue] FULL! '%s' wants to send.\n", task->name);
+    list_add(&q->xTasksWaitingToSend, task, (void *)item);
+    return false;
 }
 
-void queue_receive(Queue_t *q, TCB_t *task) {
+// Returns true if an item was copied to 'buffer', false if 'task' is now blocked
+bool queue_receive(Queue_t *q, void *buffer, TCB_t *task) {
     if (q->count > 0) {
-        int data = q->buffer[0]; // Simplified FIFO
-        q->count--;
-        printf("[Queue] '%s' received %d. (Count: %d/%d)\n", task->name, data, q->count, q->size);
-        
-        // Check if anyone was waiting to send
+        ring_pop(q, buffer); // Real FIFO: oldest item first
+        printf("[Queue] '%s' received an item. (Count: %zu/%zu)\n", task->name, q->count, q->length);
+
+        // A slot just opened: complete the highest-priority blocked send for it
         if (q->xTasksWaitingToSend.count > 0) {
-            TCB_t *writer = list_remove_first(&q->xTasksWaitingToSend);
-            // In real OS, we might let the writer write immediately or yield
-            printf("[OS] Resuming writer '%s'...\n", writer->name);
-            queue_send(q, 999, writer); // Retry send
+            TCB_t *writer = q->xTasksWaitingToSend.head;
+            ring_push(q, writer->wait_buffer);
+            printf("[Queue] Pending item from '%s' moved into the freed slot. (Count: %zu/%zu)\n",
+                   writer->name, q->count, q->length);
+            list_remove_first(&q->xTasksWaitingToSend);
         }
-    } else {
-        printf("[Queue] EMPTY! '%s' wants to receive.\n", task->name);
-        list_add(&q->xTasksWaitingToReceive, task);
+        return true;
     }
+
+    printf("[Queue] EMPTY! '%s' wants to receive.\n", task->name);
+    list_add(&q->xTasksWaitingToReceive, task, buffer);
+    return false;
 }
 
+typedef struct {
+    uint16_t sensor_id;
+    float value;
+    uint32_t timestamp;
+} SensorReading_t;
+
 int main() {
     printf("=== FreeRTOS Queue Internals Simulation ===\n");
-    
-    Queue_t q = { .size = 2, .count = 0, .xTasksWaitingToSend = {0}, .xTasksWaitingToReceive = {0} };
-    
-    TCB_t t1 = {1, "Writer1", false};
-    TCB_t t2 = {2, "Writer2", false};
-    TCB_t t3 = {3, "Writer3", false};
-    TCB_t reader = {4, "Reader", false};
-    
+
+    int storage[2];
+    Queue_t q;
+    queue_init(&q, storage, 2, sizeof(int)); // Small buffer (size 2)
+
+    TCB_t t1 = { .id = 1, .name = "Writer1", .priority = 1 };
+    TCB_t t2 = { .id = 2, .name = "Writer2", .priority = 1 };
+    TCB_t t3 = { .id = 3, .name = "Writer3", .priority = 1 };
+    TCB_t t4 = { .id = 4, .name = "UrgentWriter", .priority = 3 };
+    TCB_t reader = { .id = 5, .name = "Reader", .priority = 2 };
+
     // 1. Fill the Queue
-    queue_send(&q, 10, &t1);
-    queue_send(&q, 20, &t2);
-    
-    // 2. Overflow -> Block Writer3
-    queue_send(&q, 30, &t3); // Should block
-    
-    // 3. Reader reads one item
+    int v10 = 10, v20 = 20, v30 = 30, v40 = 40;
+    queue_send(&q, &v10, &t1);
+    queue_send(&q, &v20, &t2);
+
+    // 2. Overflow -> Block Writer3, then a higher priority writer
+    queue_send(&q, &v30, &t3); // Should block
+    queue_send(&q, &v40, &t4); // Blocks too, but jumps ahead of Writer3 in the wait list
+
+    // 3. Reader drains the queue
     printf("\n--- Reader Arrives ---\n");
-    queue_receive(&q, &reader); // Should unblock Writer3
-    
+    int data;
+    while (queue_receive(&q, &data, &reader)) {
+        printf("Reader got %d\n", data); // 10, 20, 40, 30: FIFO data, priority-ordered senders
+    }
+
+    // 4. Reader is blocked now; a send goes straight into its buffer
+    printf("\n--- Direct Hand-Off to Blocked Reader ---\n");
+    int v50 = 50;
+    queue_send(&q, &v50, &t1);
+    printf("Reader got %d (queue count still %zu)\n", data, q.count);
+
+    // 5. Arbitrary item size: whole structs are copied in and out
+    printf("\n--- Struct Items (%zu bytes each) ---\n", sizeof(SensorReading_t));
+    SensorReading_t readings[4];
+    Queue_t sensor_q;
+    queue_init(&sensor_q, readings, 4, sizeof(SensorReading_t));
+    for (uint16_t i = 0; i < 3; i++) {
+        SensorReading_t r = { .sensor_id = i, .value = 20.5f + i, .timestamp = 1000u * i };
+        queue_send(&sensor_q, &r, &t1);
+    }
+    SensorReading_t out;
+    while (sensor_q.count > 0) {
+        queue_receive(&sensor_q, &out, &reader);
+        printf("Sensor %u: %.1f @ %u\n", out.sensor_id, out.value, out.timestamp);
+    }
+
     return 0;
 }
@@ -1,11 +1,12 @@
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 
 /*
  * Race Condition & Mutex Simulation
- * 
+ *
  * Scenario: Two tasks (Task A and Task B) try to increment a shared counter.
- * 
+ *
  * The Bug (Race Condition):
  * 1. Task A reads counter (0).
  * 2. Context Switch! Task B runs.
@@ -13,38 +14,172 @@
  * 4. Task B increments and writes (1).
  * 5. Task A resumes. It has old value (0). Increments and writes (1).
  * Result: Counter is 1, but should be 2.
+ *
+ * The Fix: A blocking Mutex with Priority Inheritance.
+ * - A task that finds the mutex taken BLOCKS in the mutex's wait list
+ *   (sorted by priority) instead of spinning or retrying.
+ * - Priority Inversion: Low holds the mutex, High waits, Medium preempts Low
+ *   -> High waits for Medium too! Fix: while High waits, Low runs AT High's
+ *   priority (inheritance), so Medium can't get in.
+ * - Transitive: if the holder is itself blocked on another mutex, the boost
+ *   follows the chain to that mutex's holder.
+ * - Unlock: the holder drops back to (base priority, or the highest waiter of
+ *   any mutex it STILL holds), and the mutex goes straight to the top waiter.
+ * - Recursive mutex: the owner may lock again; it's released on the last unlock.
+ *
+ * The Other Fix: No Lock At All.
+ * - A counter only needs ONE indivisible read-modify-write: atomic_fetch_add()
+ *   (LOCK XADD on x86, LDADD on ARMv8.1). Nobody blocks, nothing to inherit.
+ * - See counter_scaling.c for how unsafe / mutex / atomic / sharded counters
+ *   scale from 1 to 64 threads.
  */
 
 int shared_counter = 0;
+atomic_int atomic_counter = 0;
+
+struct Mutex;
+
+// Simulated TCB
+typedef struct TCB {
+    int id;
+    int base_priority;            // Assigned priority
+    int priority;                 // Effective priority (may be inherited)
+    struct Mutex *blocked_on;     // Mutex this task is waiting for
+    struct Mutex *held;           // Mutexes this task holds (linked via next_held)
+    struct TCB *wait_next;        // Link in the mutex wait list
+    void (*resume)(struct TCB *); // What the task does once it gets the mutex
+} TCB_t;
 
 // Simulated Mutex
-typedef struct {
+typedef struct Mutex {
+    const char *name;
     bool is_locked;
-    int owner_id;
+    TCB_t *owner;
+    bool recursive;
+    int lock_depth;               // Recursive: how many times the owner locked it
+    TCB_t *waiters;               // Highest priority first
+    struct Mutex *next_held;
 } Mutex_t;
 
-Mutex_t my_mutex = { .is_locked = false, .owner_id = -1 };
+Mutex_t my_mutex = { .name = "CounterMutex" };
+
+// --- Wait list (sorted by priority, FIFO among equals) ---
+
+static void waitlist_insert(Mutex_t *m, TCB_t *task) {
+    TCB_t **pp = &m->waiters;
+    while (*pp != NULL && (*pp)->priority >= task->priority) pp = &(*pp)->wait_next;
+    task->wait_next = *pp;
+    *pp = task;
+}
+
+static void waitlist_remove(Mutex_t *m, TCB_t *task) {
+    TCB_t **pp = &m->waiters;
+    while (*pp != NULL && *pp != task) pp = &(*pp)->wait_next;
+    if (*pp != NULL) *pp = task->wait_next;
+    task->wait_next = NULL;
+}
 
-// Function to acquire Mutex
-bool mutex_lock(Mutex_t *m, int task_id) {
-    if (m->is_locked) {
-        printf("[Mutex] Task %d BLOCKED! Mutex held by Task %d\n", task_id, m->owner_id);
-        return false; // Failed to get lock
+static void set_priority(TCB_t *task, int priority) {
+    if (task->priority == priority) return;
+    printf("[Sched] Task %d priority %d -> %d%s\n", task->id, task->priority, priority,
+           (priority > task->base_priority) ? " (inherited)" : " (restored)");
+    task->priority = priority;
+    // A blocked task must move to its new place in the wait list
+    if (task->blocked_on != NULL) {
+        waitlist_remove(task->blocked_on, task);
+        waitlist_insert(task->blocked_on, task);
     }
+}
+
+// Effective priority = max(base, top waiter of every mutex still held)
+static void recompute_priority(TCB_t *task) {
+    int priority = task->base_priority;
+    for (Mutex_t *m = task->held; m != NULL; m = m->next_held) {
+        if (m->waiters != NULL && m->waiters->priority > priority) priority = m->waiters->priority;
+    }
+    set_priority(task, priority);
+}
+
+static void take_ownership(Mutex_t *m, TCB_t *task) {
     m->is_locked = true;
-    m->owner_id = task_id;
-    printf("[Mutex] Task %d acquired lock.\n", task_id);
-    return true;
+    m->owner = task;
+    m->lock_depth = 1;
+    m->next_held = task->held;
+    task->held = m;
+}
+
+// Function to acquire Mutex. Returns true if acquired now, false if the task BLOCKED.
+// 'resume' runs when a blocked task is later handed the mutex.
+bool mutex_lock(Mutex_t *m, TCB_t *task, void (*resume)(TCB_t *)) {
+    if (!m->is_locked) {
+        take_ownership(m, task);
+        printf("[Mutex] Task %d acquired %s.\n", task->id, m->name);
+        return true;
+    }
+
+    if (m->owner == task) {
+        if (m->recursive) {
+            m->lock_depth++;
+            printf("[Mutex] Task %d re-acquired %s (depth %d).\n", task->id, m->name, m->lock_depth);
+            return true;
+        }
+        printf("[Mutex] ERROR: Task %d already holds %s (deadlock)!\n", task->id, m->name);
+        return false;
+    }
+
+    printf("[Mutex] Task %d BLOCKED! %s held by Task %d\n", task->id, m->name, m->owner->id);
+    task->blocked_on = m;
+    task->resume = resume;
+    waitlist_insert(m, task);
+
+    // Priority Inheritance: boost the holder, and whoever IT is waiting on, and so on
+    TCB_t *holder = m->owner;
+    while (holder != NULL && holder->priority < task->priority) {
+        set_priority(holder, task->priority);
+        holder = (holder->blocked_on != NULL) ? holder->blocked_on->owner : NULL;
+    }
+    return false;
 }
 
 // Function to release Mutex
-void mutex_unlock(Mutex_t *m, int task_id) {
-    if (m->owner_id == task_id) {
-        m->is_locked = false;
-        m->owner_id = -1;
-        printf("[Mutex] Task %d released lock.\n", task_id);
-    } else {
-        printf("[Mutex] ERROR: Task %d tried to release mutex owned by Task %d!\n", task_id, m->owner_id);
+void mutex_unlock(Mutex_t *m, TCB_t *task) {
+    if (m->owner != task) {
+        printf("[Mutex] ERROR: Task %d tried to release %s owned by Task %d!\n",
+               task->id, m->name, m->owner ? m->owner->id : -1);
+        return;
+    }
+
+    if (--m->lock_depth > 0) {
+        printf("[Mutex] Task %d released %s (depth %d, still held).\n", task->id, m->name, m->lock_depth);
+        return;
+    }
+
+    // Remove from the owner's held list
+    Mutex_t **pp = &task->held;
+    while (*pp != m) pp = &(*pp)->next_held;
+    *pp = m->next_held;
+    m->next_held = NULL;
+    m->is_locked = false;
+    m->owner = NULL;
+    printf("[Mutex] Task %d released %s.\n", task->id, m->name);
+
+    recompute_priority(task); // Drop any priority inherited through this mutex
+
+    // Hand the mutex straight to the highest-priority waiter
+    TCB_t *next = m->waiters;
+    if (next != NULL) {
+        m->waiters = next->wait_next;
+        next->wait_next = NULL;
+        next->blocked_on = NULL;
+        take_ownership(m, next);
+        printf("[Mutex] %s handed to Task %d (UNBLOCKED).\n", m->name, next->id);
+        recompute_priority(next); // Inherit from anyone still waiting
+
+        if (next->resume != NULL) {
+            void (*resume)(TCB_t *) = next->resume;
+            next->resume = NULL;
+            resume(next); // The task continues where it blocked
+        }
     }
 }
 
@@ -52,31 +187,42 @@ void mutex_unlock(Mutex_t *m, int task_id) {
 void unsafe_increment(int task_id) {
     printf("Task %d reading counter... (Value: %d)\n", task_id, shared_counter);
     int temp = shared_counter;
-    
+
     // SIMULATING CONTEXT SWITCH / PREEMPTION HERE
     printf("--- Context Switch occurred! ---\n");
-    
+
     temp++;
     shared_counter = temp;
     printf("Task %d wrote counter. (New Value: %d)\n", task_id, shared_counter);
 }
 
+// The critical section, entered while holding the mutex
+void increment_and_unlock(TCB_t *task) {
+    printf("Task %d reading counter... (Value: %d)\n", task->id, shared_counter);
+    int temp = shared_counter;
+
+    // Even if context switch happens here, nobody else can touch the data!
+
+    temp++;
+    shared_counter = temp;
+    printf("Task %d wrote counter. (New Value: %d)\n", task->id, shared_counter);
+
+    mutex_unlock(&my_mutex, task);
+}
+
+// Lock-Free Increment: the read, +1 and write happen as ONE step
+void atomic_increment(int task_id) {
+    int old = atomic_fetch_add(&atomic_counter, 1);
+    // A context switch here is harmless: the update is already done
+    printf("Task %d incremented counter atomically. (%d -> %d)\n", task_id, old, old + 1);
+}
+
 // Safe Increment (With Mutex)
-void safe_increment(int task_id) {
-    if (mutex_lock(&my_mutex, task_id)) {
-        printf("Task %d reading counter... (Value: %d)\n", task_id, shared_counter);
-        int temp = shared_counter;
-        
-        // Even if context switch happens here, nobody else can touch the data!
-        
-        temp++;
-        shared_counter = temp;
-        printf("Task %d wrote counter. (New Value: %d)\n", task_id, shared_counter);
-        
-        mutex_unlock(&my_mutex, task_id);
-    } else {
-        printf("Task %d retrying later...\n", task_id);
+void safe_increment(TCB_t *task) {
+    if (mutex_lock(&my_mutex, task, increment_and_unlock)) {
+        increment_and_unlock(task);
     }
+    // else: the task sleeps in the wait list and resumes when handed the mutex
 }
 
 int main() {
@@ -89,27 +235,67 @@ int main() {
     // Task 2 Read 0
     // Task 2 Write 1
     // Task 1 Write 1 -> LOST UPDATE!
-    
+
     printf("=== 2. The Fix (Mutex) ===\n");
     shared_counter = 0;
-    
+    TCB_t task1 = { .id = 1, .base_priority = 1, .priority = 1 };
+    TCB_t task2 = { .id = 2, .base_priority = 2, .priority = 2 };
+
     // Task 1 gets the lock
-    safe_increment(1);
-    
-    // Task 2 tries to get lock but fails (or waits in a real OS)
-    // Here we simulate Task 2 trying while Task 1 holds it (conceptually)
-    // But since safe_increment releases it, let's simulate a collision:
-    
+    safe_increment(&task1);
+
     printf("\n--- Simulating Collision ---\n");
-    mutex_lock(&my_mutex, 1); // Task 1 locks it
-    
+    mutex_lock(&my_mutex, &task1, NULL); // Task 1 locks it
+
     // Task 2 tries to run
-    safe_increment(2); // Should fail/block
-    
-    mutex_unlock(&my_mutex, 1); // Task 1 releases
-    
-    // Now Task 2 can run
-    safe_increment(2);
+    safe_increment(&task2); // Blocks (no retry loop), Task 1 inherits priority 2
+
+    mutex_unlock(&my_mutex, &task1); // Task 1 releases -> Task 2 runs its increment
+    printf("Counter: %d (expected 2)\n", shared_counter);
+
+    printf("\n=== 3. Priority Inversion ===\n");
+    TCB_t low  = { .id = 10, .base_priority = 1, .priority = 1 };
+    TCB_t med  = { .id = 11, .base_priority = 2, .priority = 2 };
+    TCB_t high = { .id = 12, .base_priority = 3, .priority = 3 };
+    Mutex_t spi_bus = { .name = "SPI_Mutex" };
+
+    mutex_lock(&spi_bus, &low, NULL);
+    mutex_lock(&spi_bus, &high, NULL); // High blocks, Low is boosted to 3
+    printf("Medium (prio %d) becomes ready. Can it preempt Low (prio %d)? %s\n",
+           med.priority, low.priority, (med.priority > low.priority) ? "YES (inversion!)" : "NO");
+    mutex_unlock(&spi_bus, &low);      // Low drops back to 1, High owns the bus
+    mutex_unlock(&spi_bus, &high);
+
+    printf("\n=== 4. Transitive Inheritance (Chain) ===\n");
+    TCB_t t_a = { .id = 20, .base_priority = 1, .priority = 1 };
+    TCB_t t_b = { .id = 21, .base_priority = 2, .priority = 2 };
+    TCB_t t_c = { .id = 22, .base_priority = 5, .priority = 5 };
+    Mutex_t mutex_a = { .name = "MutexA" };
+    Mutex_t mutex_b = { .name = "MutexB" };
+
+    mutex_lock(&mutex_a, &t_a, NULL);  // A holds MutexA
+    mutex_lock(&mutex_b, &t_b, NULL);  // B holds MutexB
+    mutex_lock(&mutex_a, &t_b, NULL);  // B waits for A -> A boosted to 2
+    mutex_lock(&mutex_b, &t_c, NULL);  // C waits for B -> B boosted to 5 -> A boosted to 5
+    mutex_unlock(&mutex_a, &t_a);      // A back to 1; B gets MutexA, keeps 5 (C still waits on B)
+    mutex_unlock(&mutex_a, &t_b);
+    mutex_unlock(&mutex_b, &t_b);      // B back to 2; C gets MutexB
+    mutex_unlock(&mutex_b, &t_c);
+
+    printf("\n=== 5. Recursive Mutex ===\n");
+    Mutex_t rec = { .name = "RecursiveMutex", .recursive = true };
+    mutex_lock(&rec, &task1, NULL);
+    mutex_lock(&rec, &task1, NULL);    // Same owner: depth 2, no deadlock
+    mutex_lock(&rec, &task2, NULL);    // Other task blocks
+    mutex_unlock(&rec, &task1);        // Still held
+    mutex_unlock(&rec, &task1);        // Now released and handed to Task 2
+    mutex_unlock(&rec, &task2);
+
+    printf("\n=== 6. Lock-Free Counter (atomic_fetch_add) ===\n");
+    atomic_store(&atomic_counter, 0);
+    atomic_increment(1);
+    atomic_increment(2); // No mutex, no wait list, no priority games
+    printf("Counter: %d (expected 2)\n", atomic_load(&atomic_counter));
 
     return 0;
 }
@@ -1,6 +1,13 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <stddef.h>
+#include <time.h>
 
 /*
  * OS Scheduling Simulation
@@ -8,15 +15,153 @@
  * 1. Cooperative Scheduling (Run until completion/yield)
  * 2. Preemptive Round Robin (Time slicing)
  * 3. Priority Scheduling (Highest priority runs first)
+ * 4. Discrete-Event Engine (pluggable policies, generated workloads, metrics)
+ * 5. Schedulability Analysis (RM/DM priorities, response-time analysis, EDF demand test)
+ * 6. SMP (N cores, per-core run queues, affinity, work stealing, migration cost)
+ * 7. MLFQ and CFS-style Fair Scheduling (feedback queues; red-black tree on vruntime)
+ *
+ * Build: gcc scheduling_sim.c -O2 -lm   (log() for the exponential samples)
+ *
+ * Priority Ready List (how FreeRTOS picks the next task in O(1)):
+ * - One FIFO list per priority level (a head/tail cousin of the xLIST in linked_list.c).
+ * - A 32-bit bitmap: bit N is set while list N is non-empty.
+ * - Highest ready priority = 31 - CountLeadingZeros(bitmap).
+ *   One instruction on Cortex-M (CLZ), no matter how many tasks exist.
  */
 
+#define MAX_PRIORITIES 32 // One bit per priority in a uint32_t
+
+struct Task;
+
+// Doubly linked list node (a simpler ListItem_t, see linked_list.c), embedded in the task
+typedef struct Node {
+    struct Node *next;
+    struct Node *prev;
+    struct Task *task; // Owner of this node
+} Node_t;
+
 typedef struct {
+    Node_t *head;
+    Node_t *tail;
+    int count;
+} List_t;
+
+// Red-black tree node, embedded in the task (CFS timeline, section 7)
+typedef struct RbNode {
+    struct RbNode *parent;
+    struct RbNode *left;
+    struct RbNode *right;
+    bool red;
+} RbNode_t;
+
+typedef struct Task {
     int id;
     int burst_time;    // How long the task needs to run
     int remaining_time;
     int priority;      // Higher number = Higher priority
+    int arrival_time;  // When the task becomes ready (0 = at start)
+    Node_t ready_node; // Links the task into its priority's ready list
+
+    // Discrete-event engine only (section 4)
+    int io_every;       // Block for I/O after this much CPU (0 = never)
+    int io_time;        // How long each I/O takes
+    int run_since_io;   // CPU used since the last I/O
+    int ready_since;    // When it last became ready
+    int first_run_time; // -1 until first dispatched
+    int wait_time;      // Total time spent ready but not running
+    int deadline;       // Absolute deadline (0 = none)
+    int source;         // Periodic task that released this job (section 5)
+    uint32_t affinity;  // SMP: bit N set = may run on core N (section 6)
+    int last_core;      // SMP: core it last ran on, -1 = never ran
+    int level;          // MLFQ: queue level, 0 = top (section 7)
+    int allotment_used; // MLFQ: CPU used at this level so far
+    int boost_seen;     // MLFQ: last priority boost applied to this task
+    int nice;           // CFS: -20..19, picks the weight
+    long long vruntime; // CFS: CPU time scaled by weight
+    RbNode_t timeline_node; // CFS: links the task into the vruntime tree
 } Task_t;
 
+typedef struct {
+    List_t lists[MAX_PRIORITIES];
+    uint32_t ready_bitmap;
+} ReadyQueue_t;
+
+void list_init(List_t *list) {
+    list->head = NULL;
+    list->tail = NULL;
+    list->count = 0;
+}
+
+// Add to the END of the list (FIFO within the same priority)
+void list_insert_end(List_t *list, Node_t *node) {
+    node->next = NULL;
+    node->prev = list->tail;
+    if (list->tail != NULL) list->tail->next = node;
+    else list->head = node;
+    list->tail = node;
+    list->count++;
+}
+
+// Add to the FRONT of the list (a preempted task keeps its turn)
+void list_insert_front(List_t *list, Node_t *node) {
+    node->prev = NULL;
+    node->next = list->head;
+    if (list->head != NULL) list->head->prev = node;
+    else list->tail = node;
+    list->head = node;
+    list->count++;
+}
+
+Node_t *list_remove_first(List_t *list) {
+    Node_t *node = list->head;
+    if (node == NULL) return NULL;
+    list->head = node->next;
+    if (list->head != NULL) list->head->prev = NULL;
+    else list->tail = NULL;
+    node->next = NULL;
+    list->count--;
+    return node;
+}
+
+// Unlink a node from anywhere in the list: O(1), no search
+void list_remove(List_t *list, Node_t *node) {
+    if (node->prev != NULL) node->prev->next = node->next;
+    else list->head = node->next;
+    if (node->next != NULL) node->next->prev = node->prev;
+    else list->tail = node->prev;
+    node->next = node->prev = NULL;
+    list->count--;
+}
+
+void ready_queue_init(ReadyQueue_t *rq) {
+    for (int i = 0; i < MAX_PRIORITIES; i++) list_init(&rq->lists[i]);
+    rq->ready_bitmap = 0;
+}
+
+void ready_queue_push(ReadyQueue_t *rq, Task_t *task, bool at_front) {
+    assert(task->priority >= 0 && task->priority < MAX_PRIORITIES); // One list and one bitmap bit each
+    task->ready_node.task = task;
+    if (at_front) list_insert_front(&rq->lists[task->priority], &task->ready_node);
+    else list_insert_end(&rq->lists[task->priority], &task->ready_node);
+    rq->ready_bitmap |= (1U << task->priority);
+}
+
+// Highest priority with a ready task, or -1 if nothing is ready
+int ready_queue_top_priority(ReadyQueue_t *rq) {
+    if (rq->ready_bitmap == 0) return -1;
+    return 31 - __builtin_clz(rq->ready_bitmap);
+}
+
+Task_t *ready_queue_pop_highest(ReadyQueue_t *rq) {
+    int prio = ready_queue_top_priority(rq);
+    if (prio < 0) return NULL;
+    Node_t *node = list_remove_first(&rq->lists[prio]);
+    if (rq->lists[prio].count == 0) {
+        rq->ready_bitmap &= ~(1U << prio); // Last task at this level left
+    }
+    return node->task;
+}
+
 void run_fcfs(Task_t tasks[], int count) {
     printf("\n--- FCFS (First Come First Serve) ---\n");
     int time = 0;
@@ -28,7 +173,7 @@ void run_fcfs(Task_t tasks[], int count) {
 }
 
 void run_round_robin(Task_t tasks[], int count, int time_slice) {
-    printf("\n--- Round Robin (Time Slice: %d) ---\n");
+    printf("\n--- Round Robin (Time Slice: %d) ---\n", time_slice);
     int time = 0;
     int tasks_left = count;
     
@@ -56,43 +201,1753 @@ void run_round_robin(Task_t tasks[], int count, int time_slice) {
     }
 }
 
+static int compare_arrival(const void *a, const void *b) {
+    const Task_t *ta = *(const Task_t * const *)a;
+    const Task_t *tb = *(const Task_t * const *)b;
+    if (ta->arrival_time != tb->arrival_time) return ta->arrival_time - tb->arrival_time;
+    return ta->id - tb->id; // Keep input order for ties
+}
+
 void run_priority(Task_t tasks[], int count) {
-    printf("\n--- Priority Scheduling (Preemptive Simulation) ---\n");
-    // Simple bubble sort to order by Priority (Highest First)
-    // In a real OS, this is done by the Ready List (O(1) insertion)
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = 0; j < count - i - 1; j++) {
-            if (tasks[j].priority < tasks[j+1].priority) {
-                Task_t temp = tasks[j];
-                tasks[j] = tasks[j+1];
-                tasks[j+1] = temp;
+    printf("\n--- Priority Scheduling (Preemptive, O(1) Ready List) ---\n");
+    ReadyQueue_t rq;
+    ready_queue_init(&rq);
+
+    // Arrival order. Sorted ONCE, and the caller's array is left untouched.
+    Task_t **arrivals = malloc(count * sizeof(Task_t *));
+    if (arrivals == NULL) {
+        printf("Out of memory\n");
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        tasks[i].remaining_time = tasks[i].burst_time;
+        arrivals[i] = &tasks[i];
+    }
+    qsort(arrivals, count, sizeof(Task_t *), compare_arrival);
+
+    int time = 0;
+    int next_arrival = 0;
+    int finished = 0;
+    Task_t *current = NULL;
+
+    while (finished < count) {
+        // 1. Move every task that has arrived into its ready list: O(1) each
+        while (next_arrival < count && arrivals[next_arrival]->arrival_time <= time) {
+            Task_t *t = arrivals[next_arrival++];
+            if (t->arrival_time > 0) {
+                printf("Time %d: Task %d (Prio %d) arrives\n", time, t->id, t->priority);
+            }
+            ready_queue_push(&rq, t, false);
+        }
+
+        // 2. Preemption check: is anything ready with a HIGHER priority?
+        if (current != NULL && ready_queue_top_priority(&rq) > current->priority) {
+            printf("Time %d: Task %d PREEMPTED\n", time, current->id);
+            ready_queue_push(&rq, current, true);
+            current = NULL;
+        }
+
+        // 3. Pick the next task: one CLZ + one list pop
+        if (current == NULL) {
+            current = ready_queue_pop_highest(&rq);
+            if (current == NULL) {
+                // Nothing ready: tickless jump straight to the next arrival
+                int wake = arrivals[next_arrival]->arrival_time;
+                printf("Time %d: CPU idle, sleeping until %d (%d ticks skipped)\n", time, wake, wake - time);
+                time = wake;
+                continue;
             }
+            printf("Time %d: Task %d (Prio %d) %s\n", time, current->id, current->priority,
+                   (current->remaining_time == current->burst_time) ? "starts" : "resumes");
+        }
+
+        // 4. Run until it finishes or the next arrival (a possible preemption point)
+        int run_time = current->remaining_time;
+        if (next_arrival < count && arrivals[next_arrival]->arrival_time - time < run_time) {
+            run_time = arrivals[next_arrival]->arrival_time - time;
+        }
+        time += run_time;
+        current->remaining_time -= run_time;
+
+        if (current->remaining_time == 0) {
+            printf("Time %d: Task %d finishes\n", time, current->id);
+            finished++;
+            current = NULL;
         }
     }
 
-    int time = 0;
-    for (int i = 0; i < count; i++) {
-        printf("Time %d: Task %d (Prio %d) starts\n", time, tasks[i].id, tasks[i].priority);
-        time += tasks[i].burst_time;
-        printf("Time %d: Task %d finishes\n", time, tasks[i].id);
+    free(arrivals);
+}
+
+// ---------------------------------------------------------------------------
+// 4. Discrete-Event Engine
+// ---------------------------------------------------------------------------
+// The loops above step over a hand-written array. The engine below keeps a
+// min-heap of future events and jumps straight from one to the next, so the
+// cost is per EVENT, not per tick, and a million-task trace takes a second.
+//
+// Events: a task arrives, a blocked task's I/O completes, and the running
+// task completes, blocks for I/O or uses up its slice. Only ONE CPU event is
+// pending at a time. When a task is preempted, its event is not dug out of
+// the heap: the CPU generation number moves on, and the old event is dropped
+// when it surfaces.
+//
+// Policies plug in through SchedPolicy_t. The engine decides WHEN to
+// schedule; the policy decides WHO runs and for how long.
+
+typedef enum {
+    EV_COMPLETION,   // Running task finished its burst
+    EV_IO_BLOCK,     // Running task issues I/O and blocks
+    EV_SLICE_EXPIRY, // Running task used up its time slice
+    EV_IO_DONE,      // A blocked task is ready again
+    EV_ARRIVAL,      // Next task from the workload generator shows up
+} EventType_t;
+
+typedef struct {
+    int time;
+    uint32_t seq;     // FIFO among events of the same time and kind
+    uint32_t gen;     // CPU events: stale once the CPU has been re-dispatched
+    EventType_t type;
+    Task_t *task;
+} Event_t;
+
+typedef struct {
+    Event_t *items;
+    int count;
+    int capacity;
+    uint32_t next_seq;
+} EventQueue_t;
+
+// At the same instant, CPU events go first: a task that finishes at t is
+// done before an arrival at t could preempt it.
+static bool event_before(const Event_t *a, const Event_t *b) {
+    if (a->time != b->time) return a->time < b->time;
+    bool a_cpu = a->type <= EV_SLICE_EXPIRY, b_cpu = b->type <= EV_SLICE_EXPIRY;
+    if (a_cpu != b_cpu) return a_cpu;
+    return a->seq < b->seq;
+}
+
+void event_queue_push(EventQueue_t *q, int time, EventType_t type, Task_t *task, uint32_t gen) {
+    if (q->count == q->capacity) {
+        q->capacity = q->capacity ? q->capacity * 2 : 64;
+        Event_t *items = realloc(q->items, q->capacity * sizeof(Event_t));
+        if (items == NULL) { // A lost event would silently corrupt the run
+            printf("Out of memory\n");
+            exit(1);
+        }
+        q->items = items;
+    }
+    Event_t ev = { .time = time, .seq = q->next_seq++, .gen = gen, .type = type, .task = task };
+    int i = q->count++;
+    while (i > 0) { // Sift up
+        int parent = (i - 1) / 2;
+        if (!event_before(&ev, &q->items[parent])) break;
+        q->items[i] = q->items[parent];
+        i = parent;
+    }
+    q->items[i] = ev;
+}
+
+bool event_queue_pop(EventQueue_t *q, Event_t *out) {
+    if (q->count == 0) return false;
+    *out = q->items[0];
+    Event_t last = q->items[--q->count];
+    int i = 0;
+    for (;;) { // Sift down
+        int child = 2 * i + 1;
+        if (child >= q->count) break;
+        if (child + 1 < q->count && event_before(&q->items[child + 1], &q->items[child])) child++;
+        if (!event_before(&q->items[child], &last)) break;
+        q->items[i] = q->items[child];
+        i = child;
+    }
+    if (q->count > 0) q->items[i] = last;
+    return true;
+}
+
+// --- Policies ---
+typedef enum {
+    ENQ_NEW,       // Just arrived
+    ENQ_WOKEN,     // Back from I/O
+    ENQ_PREEMPTED, // Kicked off the CPU by a better task
+    ENQ_EXPIRED,   // Used up its slice
+} EnqueueReason_t;
+
+typedef struct SchedPolicy {
+    const char *name;
+    void (*init)(struct SchedPolicy *self);
+    void (*enqueue)(struct SchedPolicy *self, Task_t *task, EnqueueReason_t why, int now);
+    Task_t *(*pick_next)(struct SchedPolicy *self, int now);
+    // Optional hooks (NULL = default)
+    int (*time_slice)(struct SchedPolicy *self, Task_t *task);        // Default: self->slice (0 = none)
+    bool (*preempts)(struct SchedPolicy *self, Task_t *woken, Task_t *current); // Default: never
+    void (*charge)(struct SchedPolicy *self, Task_t *task, int ran, int now);   // Default: nothing
+    int slice;       // Base time slice
+    ReadyQueue_t rq; // Storage most policies need
+    void *state;     // Anything else a policy keeps
+} SchedPolicy_t;
+
+// FCFS and Round Robin share one FIFO (ready list 0). RR just adds a slice.
+static void fifo_init(SchedPolicy_t *self) {
+    ready_queue_init(&self->rq);
+}
+
+static void fifo_enqueue(SchedPolicy_t *self, Task_t *task, EnqueueReason_t why, int now) {
+    (void)why; (void)now;
+    task->ready_node.task = task;
+    list_insert_end(&self->rq.lists[0], &task->ready_node);
+}
+
+static Task_t *fifo_pick(SchedPolicy_t *self, int now) {
+    (void)now;
+    Node_t *node = list_remove_first(&self->rq.lists[0]);
+    return node ? node->task : NULL;
+}
+
+// Priority: the O(1) bitmap ready list from section 3, preemptive
+static void prio_enqueue(SchedPolicy_t *self, Task_t *task, EnqueueReason_t why, int now) {
+    (void)now;
+    ready_queue_push(&self->rq, task, why == ENQ_PREEMPTED);
+}
+
+static Task_t *prio_pick(SchedPolicy_t *self, int now) {
+    (void)now;
+    return ready_queue_pop_highest(&self->rq);
+}
+
+static bool prio_preempts(SchedPolicy_t *self, Task_t *woken, Task_t *current) {
+    (void)self;
+    return woken->priority > current->priority;
+}
+
+// A periodic task for the analysis in section 5; each release is one Task_t job
+typedef struct {
+    const char *name;
+    int period;        // T
+    int wcet;          // C: worst-case execution time
+    int deadline;      // D, relative to the release (D <= T)
+    int priority;      // Assigned by RM/DM, higher = more urgent
+    int response_time; // Worst case from RTA, -1 if it can miss its deadline
+} PeriodicTask_t;
+
+// --- Workload generators ---
+typedef enum {
+    WL_POISSON,  // Exponential gaps and bursts: the textbook M/M/1 input
+    WL_PERIODIC, // Fixed gaps, bursts within +/-25% of the mean
+    WL_BURSTY,   // Groups arriving at the same instant, exponential gaps between groups
+    WL_TASKSET,  // Every job of a periodic task set, all released together at 0
+} WorkloadKind_t;
+
+typedef struct {
+    WorkloadKind_t kind;
+    const char *name;
+    int count;          // Tasks to generate
+    double mean_gap;    // Average ticks between arrivals (per task, for every kind)
+    double mean_burst;  // Average CPU need per task
+    int group_size;     // WL_BURSTY: arrivals per group
+    int io_percent;     // Share of tasks that block for I/O
+    int io_every;       // ...after this much CPU
+    int io_time;        // ...for this long
+    int priorities;     // Priorities drawn from 0..priorities-1
+    const PeriodicTask_t *taskset; // WL_TASKSET: jobs run exactly their WCET
+    int taskset_size;
+    // Generator state
+    int generated;
+    double clock;
+    uint64_t rng;
+    int next_release[MAX_PRIORITIES]; // WL_TASKSET: per task
+} Workload_t;
+
+static uint64_t xorshift64(uint64_t *s) {
+    *s ^= *s << 13;
+    *s ^= *s >> 7;
+    *s ^= *s << 17;
+    return *s;
+}
+
+static double rng_uniform(uint64_t *s) { // (0, 1]
+    return ((xorshift64(s) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static double rng_exponential(uint64_t *s, double mean) {
+    return -mean * log(rng_uniform(s));
+}
+
+void workload_init(Workload_t *wl, uint64_t seed) {
+    wl->generated = 0;
+    wl->clock = 0;
+    wl->rng = seed ? seed : 1;
+    memset(wl->next_release, 0, sizeof(wl->next_release));
+}
+
+// Next job of a periodic task set: the earliest release, lowest index on ties
+static bool taskset_next(Workload_t *wl, Task_t *t) {
+    int k = 0;
+    for (int i = 1; i < wl->taskset_size; i++) {
+        if (wl->next_release[i] < wl->next_release[k]) k = i;
+    }
+    const PeriodicTask_t *pt = &wl->taskset[k];
+    memset(t, 0, sizeof(*t));
+    t->id = ++wl->generated;
+    t->arrival_time = wl->next_release[k];
+    t->burst_time = t->remaining_time = pt->wcet;
+    t->priority = pt->priority;
+    t->deadline = t->arrival_time + pt->deadline;
+    t->source = k;
+    t->first_run_time = -1;
+    wl->next_release[k] += pt->period;
+    return true;
+}
+
+// Fill in the next task; false once the trace is exhausted
+bool workload_next(Workload_t *wl, Task_t *t) {
+    if (wl->generated >= wl->count) return false;
+    if (wl->kind == WL_TASKSET) return taskset_next(wl, t);
+    double burst;
+    switch (wl->kind) {
+    case WL_POISSON:
+        if (wl->generated > 0) wl->clock += rng_exponential(&wl->rng, wl->mean_gap);
+        burst = rng_exponential(&wl->rng, wl->mean_burst);
+        break;
+    case WL_PERIODIC:
+        if (wl->generated > 0) wl->clock += wl->mean_gap;
+        burst = wl->mean_burst * (0.75 + 0.5 * rng_uniform(&wl->rng));
+        break;
+    default: // WL_BURSTY
+        if (wl->generated > 0 && wl->generated % wl->group_size == 0) {
+            wl->clock += rng_exponential(&wl->rng, wl->mean_gap * wl->group_size);
+        }
+        burst = rng_exponential(&wl->rng, wl->mean_burst);
+        break;
+    }
+
+    memset(t, 0, sizeof(*t));
+    t->id = ++wl->generated;
+    t->arrival_time = (int)wl->clock;
+    t->burst_time = burst < 1.0 ? 1 : (int)(burst + 0.5);
+    t->remaining_time = t->burst_time;
+    t->priority = (int)(xorshift64(&wl->rng) % (uint64_t)wl->priorities);
+    if ((int)(xorshift64(&wl->rng) % 100) < wl->io_percent) {
+        t->io_every = wl->io_every;
+        t->io_time = wl->io_time;
+    }
+    t->first_run_time = -1;
+    return true;
+}
+
+// --- Task storage: recycled, so memory follows the tasks ALIVE, not the trace ---
+#define TASK_CHUNK 1024
+
+typedef struct {
+    Task_t **chunks;
+    int chunk_count;
+    Task_t *free_list; // Linked through ready_node.task
+} TaskPool_t;
+
+static Task_t *task_alloc(TaskPool_t *pool) {
+    if (pool->free_list == NULL) {
+        Task_t *chunk = malloc(TASK_CHUNK * sizeof(Task_t));
+        Task_t **chunks = realloc(pool->chunks, (pool->chunk_count + 1) * sizeof(Task_t *));
+        if (chunk == NULL || chunks == NULL) { // Callers have nowhere to put a task
+            printf("Out of memory\n");
+            exit(1);
+        }
+        pool->chunks = chunks;
+        pool->chunks[pool->chunk_count++] = chunk;
+        for (int i = 0; i < TASK_CHUNK; i++) {
+            chunk[i].ready_node.task = pool->free_list;
+            pool->free_list = &chunk[i];
+        }
+    }
+    Task_t *t = pool->free_list;
+    pool->free_list = t->ready_node.task;
+    return t;
+}
+
+static void task_free(TaskPool_t *pool, Task_t *t) {
+    t->ready_node.task = pool->free_list;
+    pool->free_list = t;
+}
+
+static void task_pool_destroy(TaskPool_t *pool) {
+    for (int i = 0; i < pool->chunk_count; i++) free(pool->chunks[i]);
+    free(pool->chunks);
+}
+
+// --- Metrics ---
+typedef struct {
+    long long tasks_done;
+    long long busy_time;
+    long long context_switches;
+    long long events;
+    int end_time;
+    int *turnaround; // Per finished task: finish - arrival
+    int *waiting;    //                     time ready but not running
+    int *response;   //                     first run - arrival
+    long long deadline_misses;
+    int worst_response_by_source[MAX_PRIORITIES]; // Release to finish, per periodic task
+    unsigned char *interactive; // Per finished task: 1 if it did I/O (sim_run only)
+} SimResult_t;
+
+typedef struct {
+    SchedPolicy_t *policy;
+    SimResult_t *res;
+    EventQueue_t events;
+    TaskPool_t pool;
+    Task_t *current;
+    Task_t *last_run;   // To count switches, not re-dispatches of the same task
+    int dispatch_time;
+    uint32_t cpu_gen;
+} Engine_t;
+
+// Charge the running task for the CPU it used since it was dispatched
+static void engine_account(Engine_t *e, int now) {
+    Task_t *t = e->current;
+    int ran = now - e->dispatch_time;
+    t->remaining_time -= ran;
+    t->run_since_io += ran;
+    e->res->busy_time += ran;
+    if (e->policy->charge) e->policy->charge(e->policy, t, ran, now);
+}
+
+static void engine_make_ready(Engine_t *e, Task_t *t, EnqueueReason_t why, int now) {
+    t->ready_since = now;
+    e->policy->enqueue(e->policy, t, why, now);
+    if (e->current && e->policy->preempts && e->policy->preempts(e->policy, t, e->current)) {
+        engine_account(e, now);
+        e->cpu_gen++; // Its pending CPU event is now stale
+        e->current->ready_since = now;
+        e->policy->enqueue(e->policy, e->current, ENQ_PREEMPTED, now);
+        e->current = NULL;
+    }
+}
+
+static void engine_dispatch(Engine_t *e, int now) {
+    Task_t *t = e->policy->pick_next(e->policy, now);
+    if (t == NULL) return; // Idle until the next event
+    if (t != e->last_run) e->res->context_switches++;
+    e->last_run = t;
+    if (t->first_run_time < 0) t->first_run_time = now;
+    t->wait_time += now - t->ready_since;
+
+    // Run until the first of: burst done, next I/O, slice over
+    int run = t->remaining_time;
+    EventType_t type = EV_COMPLETION;
+    if (t->io_every > 0 && t->io_every - t->run_since_io < run) {
+        run = t->io_every - t->run_since_io;
+        type = EV_IO_BLOCK;
+    }
+    int slice = e->policy->time_slice ? e->policy->time_slice(e->policy, t) : e->policy->slice;
+    if (slice > 0 && slice < run) {
+        run = slice;
+        type = EV_SLICE_EXPIRY;
+    }
+    e->current = t;
+    e->dispatch_time = now;
+    event_queue_push(&e->events, now + run, type, t, ++e->cpu_gen);
+}
+
+void sim_run(SchedPolicy_t *policy, Workload_t *wl, SimResult_t *res) {
+    Engine_t e = { .policy = policy, .res = res };
+    memset(res, 0, sizeof(*res));
+    res->turnaround = malloc(wl->count * sizeof(int));
+    res->waiting = malloc(wl->count * sizeof(int));
+    res->response = malloc(wl->count * sizeof(int));
+    res->interactive = malloc(wl->count);
+    if (!res->turnaround || !res->waiting || !res->response || !res->interactive) {
+        printf("Out of memory\n");
+        free(res->turnaround);
+        free(res->waiting);
+        free(res->response);
+        free(res->interactive);
+        memset(res, 0, sizeof(*res)); // Empty result, safe to print and free
+        return;
+    }
+    policy->init(policy);
+
+    // Arrivals are generated lazily: one pending at a time
+    Task_t *first = task_alloc(&e.pool);
+    if (workload_next(wl, first)) event_queue_push(&e.events, first->arrival_time, EV_ARRIVAL, first, 0);
+    else task_free(&e.pool, first);
+
+    Event_t ev;
+    while (event_queue_pop(&e.events, &ev)) {
+        int now = ev.time;
+        Task_t *t = ev.task;
+        res->events++;
+
+        switch (ev.type) {
+        case EV_ARRIVAL: {
+            Task_t *next = task_alloc(&e.pool);
+            if (workload_next(wl, next)) event_queue_push(&e.events, next->arrival_time, EV_ARRIVAL, next, 0);
+            else task_free(&e.pool, next);
+            engine_make_ready(&e, t, ENQ_NEW, now);
+            break;
+        }
+        case EV_IO_DONE:
+            engine_make_ready(&e, t, ENQ_WOKEN, now);
+            break;
+        default: // CPU events
+            if (ev.gen != e.cpu_gen) continue; // Task was preempted meanwhile
+            engine_account(&e, now);
+            e.current = NULL;
+            if (ev.type == EV_COMPLETION) {
+                long long i = res->tasks_done++;
+                res->turnaround[i] = now - t->arrival_time;
+                res->waiting[i] = t->wait_time;
+                res->response[i] = t->first_run_time - t->arrival_time;
+                res->interactive[i] = t->io_every > 0;
+                res->end_time = now;
+                if (t->deadline > 0) {
+                    if (now > t->deadline) res->deadline_misses++;
+                    int *worst = &res->worst_response_by_source[t->source];
+                    if (now - t->arrival_time > *worst) *worst = now - t->arrival_time;
+                }
+                task_free(&e.pool, t);
+            } else if (ev.type == EV_IO_BLOCK) {
+                t->run_since_io = 0;
+                event_queue_push(&e.events, now + t->io_time, EV_IO_DONE, t, 0);
+            } else { // EV_SLICE_EXPIRY
+                engine_make_ready(&e, t, ENQ_EXPIRED, now);
+            }
+            break;
+        }
+
+        // Dispatch once every event of this instant is in
+        if (e.current == NULL && (e.events.count == 0 || e.events.items[0].time > now)) {
+            engine_dispatch(&e, now);
+        }
+    }
+
+    free(e.events.items);
+    task_pool_destroy(&e.pool);
+}
+
+static int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts in place; returns the mean and fills p50/p99/max
+static double summarize(int *v, long long n, int *p50, int *p99, int *max) {
+    if (n == 0) {
+        *p50 = *p99 = *max = 0;
+        return 0;
+    }
+    qsort(v, n, sizeof(int), compare_int);
+    long long sum = 0;
+    for (long long i = 0; i < n; i++) sum += v[i];
+    *p50 = v[n / 2];
+    *p99 = v[n * 99 / 100];
+    *max = v[n - 1];
+    return (double)sum / n;
+}
+
+void print_result_header() {
+    printf("%-9s %-8s %8s %5s %8s | %-20s | %-17s | %-17s\n", "Workload", "Policy", "Thru/1k", "Util",
+           "CtxSw", "Turn mean/p50/p99", "Waiting mean/p99", "Response mean/p99");
+}
+
+void print_result(const char *workload, const char *policy, SimResult_t *r) {
+    int p50, p99, max, w50, w99, wmax, r50, r99, rmax;
+    double ta = summarize(r->turnaround, r->tasks_done, &p50, &p99, &max);
+    double wa = summarize(r->waiting, r->tasks_done, &w50, &w99, &wmax);
+    double ra = summarize(r->response, r->tasks_done, &r50, &r99, &rmax);
+    double span = r->end_time > 0 ? r->end_time : 1;
+    printf("%-9s %-8s %8.2f %4.0f%% %8lld | %7.1f %5d %6d | %9.1f %7d | %9.1f %7d\n", workload, policy,
+           1000.0 * r->tasks_done / span, 100.0 * r->busy_time / span, r->context_switches,
+           ta, p50, p99, wa, w99, ra, r99);
+}
+
+void sim_result_free(SimResult_t *r) {
+    free(r->turnaround);
+    free(r->waiting);
+    free(r->response);
+    free(r->interactive);
+}
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void run_policy_comparison(int tasks_per_trace) {
+    printf("\n--- Discrete-Event Engine: %d tasks per trace, ~90%% load ---\n", tasks_per_trace);
+    SchedPolicy_t policies[] = {
+        { .name = "FCFS", .init = fifo_init, .enqueue = fifo_enqueue, .pick_next = fifo_pick },
+        { .name = "RR", .init = fifo_init, .enqueue = fifo_enqueue, .pick_next = fifo_pick, .slice = 4 },
+        { .name = "Priority", .init = fifo_init, .enqueue = prio_enqueue, .pick_next = prio_pick,
+          .preempts = prio_preempts },
+    };
+    // Mean burst 9 ticks every 10 ticks = 90% busy. A third of the tasks are
+    // "interactive": they block for 20 ticks after every 2 ticks of CPU.
+    Workload_t workloads[] = {
+        { .kind = WL_POISSON, .name = "Poisson", .mean_gap = 10, .mean_burst = 9 },
+        { .kind = WL_PERIODIC, .name = "Periodic", .mean_gap = 10, .mean_burst = 9 },
+        { .kind = WL_BURSTY, .name = "Bursty", .mean_gap = 10, .mean_burst = 9, .group_size = 20 },
+    };
+
+    print_result_header();
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+        for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+            Workload_t *wl = &workloads[w];
+            wl->count = tasks_per_trace;
+            wl->io_percent = 33;
+            wl->io_every = 2;
+            wl->io_time = 20;
+            wl->priorities = 8;
+            workload_init(wl, 42); // Same trace for every policy
+
+            SimResult_t r;
+            sim_run(&policies[p], wl, &r);
+            print_result(wl->name, policies[p].name, &r);
+            sim_result_free(&r);
+        }
+    }
+}
+
+void run_million_task_trace() {
+    SchedPolicy_t rr = { .name = "RR", .init = fifo_init, .enqueue = fifo_enqueue, .pick_next = fifo_pick,
+                         .slice = 4 };
+    Workload_t wl = { .kind = WL_POISSON, .name = "Poisson", .count = 1000000, .mean_gap = 10,
+                      .mean_burst = 9, .io_percent = 33, .io_every = 2, .io_time = 20, .priorities = 8 };
+    workload_init(&wl, 7);
+
+    uint64_t t0 = now_ns();
+    SimResult_t r;
+    sim_run(&rr, &wl, &r);
+    double secs = (now_ns() - t0) / 1e9;
+
+    printf("\n--- One Million Tasks (Poisson, RR) ---\n");
+    print_result_header();
+    print_result(wl.name, rr.name, &r);
+    printf("%lld events in %.2f s (%.1f M events/s, %.0f ns/event)\n", r.events, secs,
+           r.events / secs / 1e6, secs * 1e9 / r.events);
+    sim_result_free(&r);
+}
+
+// ---------------------------------------------------------------------------
+// 5. Schedulability Analysis
+// ---------------------------------------------------------------------------
+// Picking priorities by hand is guesswork. For periodic tasks the question
+// has an exact answer:
+//  - Rate monotonic (RM): shorter period = higher priority. Deadline
+//    monotonic (DM): shorter deadline = higher priority. DM is the optimal
+//    fixed-priority order when D <= T, and it is the same as RM when D = T.
+//  - Response-time analysis (RTA): a task's worst case is its own C plus
+//    everything higher priority releases meanwhile:
+//        R = C_i + sum(j > i) ceil(R / T_j) * C_j
+//    iterated until R stops changing (or passes D_i).
+//  - EDF: schedulable iff at every absolute deadline t, the work that MUST
+//    be done by t (the demand bound) fits in t. Only deadlines inside the
+//    first busy period need checking, and QPA (Zhang & Burns) walks back
+//    from its end touching just a few of them, even at U = 1.
+// Both run in microseconds, so they work as an admission test: try the new
+// task on a copy of the set and refuse it if anything could miss.
+
+typedef enum {
+    ASSIGN_RATE_MONOTONIC,
+    ASSIGN_DEADLINE_MONOTONIC,
+} PriorityAssignment_t;
+
+// Priority = number of tasks less urgent than this one (ties: lower index wins)
+void assign_priorities(PeriodicTask_t *ts, int n, PriorityAssignment_t how) {
+    for (int i = 0; i < n; i++) {
+        int ki = (how == ASSIGN_RATE_MONOTONIC) ? ts[i].period : ts[i].deadline;
+        int prio = 0;
+        for (int j = 0; j < n; j++) {
+            int kj = (how == ASSIGN_RATE_MONOTONIC) ? ts[j].period : ts[j].deadline;
+            if (kj > ki || (kj == ki && j > i)) prio++;
+        }
+        ts[i].priority = prio;
+    }
+}
+
+// Fills response_time for every task; true if all meet their deadlines
+bool response_time_analysis(PeriodicTask_t *ts, int n) {
+    bool schedulable = true;
+    for (int i = 0; i < n; i++) {
+        long long r = ts[i].wcet, prev = 0;
+        while (r != prev && r <= ts[i].deadline) {
+            prev = r;
+            r = ts[i].wcet;
+            for (int j = 0; j < n; j++) {
+                if (ts[j].priority > ts[i].priority) {
+                    r += (prev + ts[j].period - 1) / ts[j].period * ts[j].wcet;
+                }
+            }
+        }
+        ts[i].response_time = (r <= ts[i].deadline) ? (int)r : -1;
+        if (r > ts[i].deadline) schedulable = false;
+    }
+    return schedulable;
+}
+
+double taskset_utilization(const PeriodicTask_t *ts, int n) {
+    double u = 0;
+    for (int i = 0; i < n; i++) u += (double)ts[i].wcet / ts[i].period;
+    return u;
+}
+
+static long long gcd(long long a, long long b) {
+    while (b != 0) {
+        long long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+#define HYPERPERIOD_CAP 1000000000LL
+
+// LCM of the periods, or -1 if it reaches HYPERPERIOD_CAP (too long to use)
+long long hyperperiod(const PeriodicTask_t *ts, int n) {
+    long long h = 1;
+    for (int i = 0; i < n; i++) {
+        h = h / gcd(h, ts[i].period) * ts[i].period;
+        if (h >= HYPERPERIOD_CAP) return -1;
+    }
+    return h;
+}
+
+// Work with both release and deadline inside [0, t]
+static long long demand_bound(const PeriodicTask_t *ts, int n, long long t) {
+    long long demand = 0;
+    for (int i = 0; i < n; i++) {
+        if (t >= ts[i].deadline) demand += ((t - ts[i].deadline) / ts[i].period + 1) * ts[i].wcet;
+    }
+    return demand;
+}
+
+// Latest absolute deadline strictly before t (0 if there is none)
+static long long deadline_before(const PeriodicTask_t *ts, int n, long long t) {
+    long long latest = 0;
+    for (int i = 0; i < n; i++) {
+        if (t <= ts[i].deadline) continue;
+        long long d = ts[i].deadline + (t - ts[i].deadline - 1) / ts[i].period * ts[i].period;
+        if (d > latest) latest = d;
+    }
+    return latest;
+}
+
+// Length of the first busy period after a synchronous release, or -1 if it
+// reaches HYPERPERIOD_CAP (then nothing is proven)
+static long long busy_period(const PeriodicTask_t *ts, int n) {
+    long long w = 0, prev = -1;
+    for (int i = 0; i < n; i++) w += ts[i].wcet;
+    while (w != prev) {
+        prev = w;
+        w = 0;
+        for (int i = 0; i < n; i++) w += (prev + ts[i].period - 1) / ts[i].period * ts[i].wcet;
+        if (w >= HYPERPERIOD_CAP) return -1;
+    }
+    return w;
+}
+
+bool edf_demand_test(const PeriodicTask_t *ts, int n) {
+    double u = taskset_utilization(ts, n);
+    if (u > 1.0 + 1e-9) return false;
+
+    bool implicit = true;
+    for (int i = 0; i < n; i++) implicit &= (ts[i].deadline == ts[i].period);
+    if (implicit) return true; // D = T: U <= 1 is exact
+
+    // Past the first busy period the CPU has idled once and everything repeats,
+    // so no later deadline can fail first. If U < 1, L_a may stop us sooner.
+    long long limit = busy_period(ts, n);
+    if (limit < 0) return false; // Too long to check: refuse rather than guess
+    int dmin = ts[0].deadline;
+    for (int i = 1; i < n; i++) if (ts[i].deadline < dmin) dmin = ts[i].deadline;
+    if (u < 1.0 - 1e-9) {
+        double la = 0;
+        int dmax = 0;
+        for (int i = 0; i < n; i++) {
+            la += (double)(ts[i].period - ts[i].deadline) * ts[i].wcet / ts[i].period;
+            if (ts[i].deadline > dmax) dmax = ts[i].deadline;
+        }
+        long long bound = (long long)ceil(la / (1.0 - u));
+        if (bound < dmax) bound = dmax;
+        if (bound < limit) limit = bound;
+    }
+
+    // QPA: start at the last deadline in range and jump straight back to the
+    // demand there. Each jump skips every deadline that demand already covers.
+    long long t = deadline_before(ts, n, limit + 1);
+    long long h = demand_bound(ts, n, t);
+    while (h <= t && h > dmin) {
+        t = (h < t) ? h : deadline_before(ts, n, t);
+        h = demand_bound(ts, n, t);
+    }
+    return h <= dmin;
+}
+
+// Admission control: would the set still be schedulable with one more task?
+bool admit_task(const PeriodicTask_t *ts, int n, PeriodicTask_t candidate, bool edf) {
+    PeriodicTask_t trial[MAX_PRIORITIES];
+    if (n + 1 > MAX_PRIORITIES) return false; // Out of priority levels
+    memcpy(trial, ts, n * sizeof(PeriodicTask_t));
+    trial[n] = candidate;
+    if (edf) return edf_demand_test(trial, n + 1);
+    assign_priorities(trial, n + 1, ASSIGN_DEADLINE_MONOTONIC);
+    return response_time_analysis(trial, n + 1);
+}
+
+// EDF dispatcher: ready jobs in a min-heap on absolute deadline
+typedef struct {
+    Task_t **items;
+    int count;
+    int capacity;
+} TaskHeap_t;
+
+static bool edf_before(const Task_t *a, const Task_t *b) {
+    if (a->deadline != b->deadline) return a->deadline < b->deadline;
+    return a->id < b->id;
+}
+
+static void edf_init(SchedPolicy_t *self) {
+    ((TaskHeap_t *)self->state)->count = 0;
+}
+
+static void edf_enqueue(SchedPolicy_t *self, Task_t *task, EnqueueReason_t why, int now) {
+    (void)why; (void)now;
+    TaskHeap_t *h = self->state;
+    if (h->count == h->capacity) {
+        h->capacity = h->capacity ? h->capacity * 2 : 32;
+        Task_t **items = realloc(h->items, h->capacity * sizeof(Task_t *));
+        if (items == NULL) {
+            printf("Out of memory\n");
+            exit(1);
+        }
+        h->items = items;
+    }
+    int i = h->count++;
+    while (i > 0 && edf_before(task, h->items[(i - 1) / 2])) {
+        h->items[i] = h->items[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->items[i] = task;
+}
+
+static Task_t *edf_pick(SchedPolicy_t *self, int now) {
+    (void)now;
+    TaskHeap_t *h = self->state;
+    if (h->count == 0) return NULL;
+    Task_t *top = h->items[0];
+    Task_t *last = h->items[--h->count];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= h->count) break;
+        if (child + 1 < h->count && edf_before(h->items[child + 1], h->items[child])) child++;
+        if (!edf_before(h->items[child], last)) break;
+        h->items[i] = h->items[child];
+        i = child;
+    }
+    if (h->count > 0) h->items[i] = last;
+    return top;
+}
+
+static bool edf_preempts(SchedPolicy_t *self, Task_t *woken, Task_t *current) {
+    (void)self;
+    return woken->deadline < current->deadline;
+}
+
+// One hyperperiod from a synchronous release (every task at 0): for fixed
+// priorities with D <= T, that is the critical instant, so the worst response
+// seen here must EQUAL the RTA bound, not just stay below it.
+// Returns false (and leaves r alone) if the hyperperiod is too long to simulate.
+#define TASKSET_MAX_JOBS 10000000LL
+
+static bool simulate_taskset(SchedPolicy_t *policy, const PeriodicTask_t *ts, int n, SimResult_t *r) {
+    long long h = hyperperiod(ts, n);
+    if (h < 0) return false;
+    long long jobs = 0;
+    for (int i = 0; i < n; i++) jobs += h / ts[i].period;
+    if (jobs > TASKSET_MAX_JOBS) return false;
+
+    Workload_t wl = { .kind = WL_TASKSET, .name = "Taskset", .taskset = ts, .taskset_size = n };
+    wl.count = (int)jobs;
+    workload_init(&wl, 1);
+    sim_run(policy, &wl, r);
+    return true;
+}
+
+static void check_taskset(const char *title, PeriodicTask_t *ts, int n) {
+    TaskHeap_t edf_heap = { 0 };
+    SchedPolicy_t fixed = { .name = "DM", .init = fifo_init, .enqueue = prio_enqueue, .pick_next = prio_pick,
+                            .preempts = prio_preempts };
+    SchedPolicy_t edf = { .name = "EDF", .init = edf_init, .enqueue = edf_enqueue, .pick_next = edf_pick,
+                          .preempts = edf_preempts, .state = &edf_heap };
+
+    assign_priorities(ts, n, ASSIGN_DEADLINE_MONOTONIC);
+    bool rta_ok = response_time_analysis(ts, n);
+    bool edf_ok = edf_demand_test(ts, n);
+    double u = taskset_utilization(ts, n);
+
+    long long h = hyperperiod(ts, n);
+    printf("\n%s: U = %.3f (Liu & Layland bound %.3f), hyperperiod ", title, u, n * (pow(2.0, 1.0 / n) - 1));
+    if (h < 0) printf(">= %lld\n", HYPERPERIOD_CAP);
+    else printf("%lld\n", h);
+
+    SimResult_t fp_run, edf_run;
+    if (!simulate_taskset(&fixed, ts, n, &fp_run) || !simulate_taskset(&edf, ts, n, &edf_run)) {
+        printf("  Hyperperiod too long to simulate; DM + RTA: %s, EDF demand: %s\n",
+               rta_ok ? "schedulable" : "NOT schedulable", edf_ok ? "schedulable" : "NOT schedulable");
+        return; // Both runs share the hyperperiod, so neither ran
+    }
+    printf("  %-7s %5s %5s %5s %5s %8s %10s\n", "Task", "T", "C", "D", "Prio", "RTA R", "Sim worst");
+    for (int i = 0; i < n; i++) {
+        char rta[16];
+        if (ts[i].response_time >= 0) snprintf(rta, sizeof(rta), "%d", ts[i].response_time);
+        else snprintf(rta, sizeof(rta), "MISS");
+        printf("  %-7s %5d %5d %5d %5d %8s %10d\n", ts[i].name, ts[i].period, ts[i].wcet, ts[i].deadline,
+               ts[i].priority, rta, fp_run.worst_response_by_source[i]);
+    }
+    printf("  DM  + RTA: %-15s simulated misses: %lld\n", rta_ok ? "schedulable" : "NOT schedulable",
+           fp_run.deadline_misses);
+    printf("  EDF demand: %-14s simulated misses: %lld\n", edf_ok ? "schedulable" : "NOT schedulable",
+           edf_run.deadline_misses);
+
+    sim_result_free(&fp_run);
+    sim_result_free(&edf_run);
+    free(edf_heap.items);
+}
+
+void run_schedulability_demo() {
+    printf("\n--- Schedulability Analysis (checked against the simulator) ---");
+    PeriodicTask_t control[] = {
+        { .name = "Motor",  .period = 10,  .wcet = 2,  .deadline = 10 },
+        { .name = "Sensor", .period = 20,  .wcet = 4,  .deadline = 15 },
+        { .name = "Comms",  .period = 40,  .wcet = 8,  .deadline = 40 },
+        { .name = "Logger", .period = 50,  .wcet = 5,  .deadline = 50 },
+        { .name = "UI",     .period = 100, .wcet = 10, .deadline = 90 },
+    };
+    int n = sizeof(control) / sizeof(control[0]);
+    check_taskset("Control loop set", control, n);
+
+    // Over the RM bound: fixed priorities miss, EDF uses the CPU to 97%
+    PeriodicTask_t tight[] = {
+        { .name = "Fast", .period = 5, .wcet = 2, .deadline = 5 },
+        { .name = "Slow", .period = 7, .wcet = 4, .deadline = 7 },
+    };
+    check_taskset("Tight set", tight, 2);
+
+    printf("\nAdmission control on the control loop set:\n");
+    PeriodicTask_t candidates[] = {
+        { .name = "Camera", .period = 25, .wcet = 3, .deadline = 25 },
+        { .name = "Audio",  .period = 25, .wcet = 4, .deadline = 25 },
+        { .name = "Crypto", .period = 40, .wcet = 6, .deadline = 12 },
+        { .name = "Video",  .period = 20, .wcet = 6, .deadline = 20 },
+    };
+    for (size_t c = 0; c < sizeof(candidates) / sizeof(candidates[0]); c++) {
+        const int reps = 1000;
+        bool fp = false, edf = false;
+        uint64_t t0 = now_ns();
+        for (int r = 0; r < reps; r++) fp = admit_task(control, n, candidates[c], false);
+        uint64_t t1 = now_ns();
+        for (int r = 0; r < reps; r++) edf = admit_task(control, n, candidates[c], true);
+        uint64_t t2 = now_ns();
+        printf("  + %-7s (T=%d C=%d D=%d): DM %-6s in %5.2f us, EDF %-6s in %5.2f us\n", candidates[c].name,
+               candidates[c].period, candidates[c].wcet, candidates[c].deadline, fp ? "admit" : "REJECT",
+               (t1 - t0) / 1000.0 / reps, edf ? "admit" : "REJECT", (t2 - t1) / 1000.0 / reps);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 6. SMP: N Cores, Per-Core Run Queues, Work Stealing
+// ---------------------------------------------------------------------------
+// Every core has its own ready deque, so cores do not all contend for one
+// shared ready list.
+//  - Placement: a new task is put on a core (round robin or least loaded). A
+//    task back from I/O returns to the core it last ran on (its cache is warm).
+//  - Affinity: bit N of the mask allows core N. Pinned tasks never move.
+//  - Work stealing: an idle core takes from the TAIL of the busiest core's
+//    deque. The owner works at the head, so the two rarely meet, and the
+//    tail task is the one that would have waited longest anyway.
+//  - Migration cost: running on a different core than last time costs
+//    migration_cost ticks of cache refill. It is CPU time that does no work.
+// Round robin inside each core. There is no cross-core preemption: a core
+// only looks for work when its current task stops.
+
+#define MAX_CORES 8
+
+typedef enum {
+    PLACE_ROUND_ROBIN,  // Next allowed core in turn
+    PLACE_LEAST_LOADED, // Allowed core with the fewest tasks (queued + running)
+} Placement_t;
+
+typedef struct {
+    const char *name;
+    int cores;
+    int slice;
+    Placement_t placement;
+    bool work_stealing;
+    int migration_cost;
+    int pinned_percent; // Share of tasks pinned to one core
+} SmpConfig_t;
+
+typedef struct {
+    List_t deque;       // Owner takes the head, thieves take the tail
+    Task_t *current;    // One pxCurrentTCB per core
+    Task_t *last_run;
+    int dispatch_time;
+    int penalty;        // Migration cost inside the current run
+    long long busy_time;
+    long long steals;
+    long long migrations;
+} Core_t;
+
+typedef struct {
+    const SmpConfig_t *cfg;
+    Core_t cores[MAX_CORES];
+    SimResult_t *res;
+    EventQueue_t events;
+    TaskPool_t pool;
+    int rr_cursor;
+} Smp_t;
+
+static bool core_allowed(const Task_t *t, int core) {
+    return (t->affinity >> core) & 1u;
+}
+
+static int core_load(const Core_t *c) {
+    return c->deque.count + (c->current != NULL);
+}
+
+static void smp_enqueue(Smp_t *smp, Task_t *t, int core, int now) {
+    t->ready_since = now;
+    t->ready_node.task = t;
+    list_insert_end(&smp->cores[core].deque, &t->ready_node);
+}
+
+static int smp_place(Smp_t *smp, const Task_t *t) {
+    int n = smp->cfg->cores;
+    if (smp->cfg->placement == PLACE_ROUND_ROBIN) {
+        for (int i = 0; i < n; i++) {
+            int core = (smp->rr_cursor + i) % n;
+            if (core_allowed(t, core)) {
+                smp->rr_cursor = (core + 1) % n;
+                return core;
+            }
+        }
+    }
+    int best = -1;
+    for (int core = 0; core < n; core++) {
+        if (!core_allowed(t, core)) continue;
+        if (best < 0 || core_load(&smp->cores[core]) < core_load(&smp->cores[best])) best = core;
+    }
+    return best;
+}
+
+// Busiest victim first; within it, the task nearest the tail we may run
+static Task_t *smp_steal(Smp_t *smp, int thief) {
+    bool tried[MAX_CORES] = { false };
+    tried[thief] = true;
+    for (int attempt = 1; attempt < smp->cfg->cores; attempt++) {
+        int victim = -1;
+        for (int core = 0; core < smp->cfg->cores; core++) {
+            if (tried[core] || smp->cores[core].deque.count == 0) continue;
+            if (victim < 0 || smp->cores[core].deque.count > smp->cores[victim].deque.count) victim = core;
+        }
+        if (victim < 0) return NULL;
+        tried[victim] = true;
+        List_t *dq = &smp->cores[victim].deque;
+        for (Node_t *node = dq->tail; node != NULL; node = node->prev) {
+            if (core_allowed(node->task, thief)) {
+                list_remove(dq, node);
+                smp->cores[thief].steals++;
+                return node->task;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void smp_dispatch(Smp_t *smp, int core, int now) {
+    Core_t *c = &smp->cores[core];
+    Node_t *node = list_remove_first(&c->deque);
+    Task_t *t = node ? node->task : NULL;
+    if (t == NULL && smp->cfg->work_stealing) t = smp_steal(smp, core);
+    if (t == NULL) return; // Core idles until something lands on it
+
+    if (t != c->last_run) smp->res->context_switches++;
+    c->last_run = t;
+    if (t->first_run_time < 0) t->first_run_time = now;
+    t->wait_time += now - t->ready_since;
+
+    c->penalty = 0;
+    if (t->last_core >= 0 && t->last_core != core) {
+        c->penalty = smp->cfg->migration_cost;
+        c->migrations++;
+    }
+    t->last_core = core;
+
+    int run = t->remaining_time;
+    EventType_t type = EV_COMPLETION;
+    if (t->io_every > 0 && t->io_every - t->run_since_io < run) {
+        run = t->io_every - t->run_since_io;
+        type = EV_IO_BLOCK;
+    }
+    if (smp->cfg->slice > 0 && smp->cfg->slice < run) {
+        run = smp->cfg->slice;
+        type = EV_SLICE_EXPIRY;
+    }
+    c->current = t;
+    c->dispatch_time = now;
+    event_queue_push(&smp->events, now + c->penalty + run, type, t, (uint32_t)core);
+}
+
+// Same event loop as sim_run, with one running task per core.
+// Fills res (as sim_run does) and cores_out (per-core counters).
+void smp_run(const SmpConfig_t *cfg, Workload_t *wl, SimResult_t *res, Core_t *cores_out) {
+    assert(cfg->cores >= 1 && cfg->cores <= MAX_CORES); // Sizes smp.cores[] and the affinity mask
+    Smp_t smp = { .cfg = cfg, .res = res };
+    memset(res, 0, sizeof(*res));
+    res->turnaround = malloc(wl->count * sizeof(int));
+    res->waiting = malloc(wl->count * sizeof(int));
+    res->response = malloc(wl->count * sizeof(int));
+    if (!res->turnaround || !res->waiting || !res->response) {
+        printf("Out of memory\n");
+        free(res->turnaround);
+        free(res->waiting);
+        free(res->response);
+        memset(res, 0, sizeof(*res));
+        memset(cores_out, 0, cfg->cores * sizeof(Core_t));
+        return;
+    }
+    for (int i = 0; i < cfg->cores; i++) list_init(&smp.cores[i].deque);
+
+    uint32_t all_cores = (cfg->cores >= 32) ? 0xFFFFFFFFu : ((1u << cfg->cores) - 1);
+    uint64_t pin_rng = 99;
+
+    Task_t *first = task_alloc(&smp.pool);
+    if (workload_next(wl, first)) event_queue_push(&smp.events, first->arrival_time, EV_ARRIVAL, first, 0);
+    else task_free(&smp.pool, first);
+
+    Event_t ev;
+    while (event_queue_pop(&smp.events, &ev)) {
+        int now = ev.time;
+        Task_t *t = ev.task;
+        res->events++;
+
+        switch (ev.type) {
+        case EV_ARRIVAL: {
+            Task_t *next = task_alloc(&smp.pool);
+            if (workload_next(wl, next)) event_queue_push(&smp.events, next->arrival_time, EV_ARRIVAL, next, 0);
+            else task_free(&smp.pool, next);
+
+            bool pinned = (int)(xorshift64(&pin_rng) % 100) < cfg->pinned_percent;
+            t->affinity = pinned ? 1u << (xorshift64(&pin_rng) % (uint64_t)cfg->cores) : all_cores;
+            t->last_core = -1;
+            smp_enqueue(&smp, t, smp_place(&smp, t), now);
+            break;
+        }
+        case EV_IO_DONE:
+            smp_enqueue(&smp, t, t->last_core, now); // Back to its warm cache
+            break;
+        default: { // CPU events: gen carries the core
+            Core_t *c = &smp.cores[ev.gen];
+            int ran = now - c->dispatch_time;
+            int work = ran - c->penalty;
+            t->remaining_time -= work;
+            t->run_since_io += work;
+            c->busy_time += ran;
+            res->busy_time += ran;
+            c->current = NULL;
+
+            if (ev.type == EV_COMPLETION) {
+                long long i = res->tasks_done++;
+                res->turnaround[i] = now - t->arrival_time;
+                res->waiting[i] = t->wait_time;
+                res->response[i] = t->first_run_time - t->arrival_time;
+                res->end_time = now;
+                task_free(&smp.pool, t);
+            } else if (ev.type == EV_IO_BLOCK) {
+                t->run_since_io = 0;
+                event_queue_push(&smp.events, now + t->io_time, EV_IO_DONE, t, 0);
+            } else { // EV_SLICE_EXPIRY: back of its own core's deque
+                smp_enqueue(&smp, t, (int)ev.gen, now);
+            }
+            break;
+        }
+        }
+
+        // Once this instant is complete, every idle core looks for work
+        if (smp.events.count == 0 || smp.events.items[0].time > now) {
+            for (int core = 0; core < cfg->cores; core++) {
+                if (smp.cores[core].current == NULL) smp_dispatch(&smp, core, now);
+            }
+        }
+    }
+
+    memcpy(cores_out, smp.cores, cfg->cores * sizeof(Core_t));
+    free(smp.events.items);
+    task_pool_destroy(&smp.pool);
+}
+
+void run_smp_demo(int tasks_per_trace) {
+    printf("\n--- SMP: Per-Core Run Queues (%d tasks, ~90%% load, 20%% pinned) ---\n", tasks_per_trace);
+    SmpConfig_t configs[] = {
+        { .name = "RR place",     .placement = PLACE_ROUND_ROBIN,  .work_stealing = false, .migration_cost = 2 },
+        { .name = "Least loaded", .placement = PLACE_LEAST_LOADED, .work_stealing = false, .migration_cost = 2 },
+        { .name = "RR + steal",   .placement = PLACE_ROUND_ROBIN,  .work_stealing = true,  .migration_cost = 2 },
+        { .name = "Least + steal", .placement = PLACE_LEAST_LOADED, .work_stealing = true, .migration_cost = 2 },
+        { .name = "Steal, mig 20", .placement = PLACE_ROUND_ROBIN, .work_stealing = true,  .migration_cost = 20 },
+    };
+    int core_counts[] = { 2, 4 };
+
+    printf("%-5s %-14s %8s %9s %8s %7s %7s | %-17s | %-17s\n", "Cores", "Placement", "Thru/1k", "Util lo-hi",
+           "CtxSw", "Steals", "Migr", "Turn mean/p99", "Response mean/p99");
+    for (int k = 0; k < 2; k++) {
+        int n = core_counts[k];
+        for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+            SmpConfig_t cfg = configs[i];
+            cfg.cores = n;
+            cfg.slice = 4;
+            cfg.pinned_percent = 20;
+            // Same per-core load as section 4: a 9-tick burst every 10 ticks per core
+            Workload_t wl = { .kind = WL_POISSON, .name = "Poisson", .count = tasks_per_trace,
+                              .mean_gap = 10.0 / n, .mean_burst = 9, .io_percent = 33, .io_every = 2,
+                              .io_time = 20, .priorities = 1 };
+            workload_init(&wl, 42);
+
+            SimResult_t r;
+            Core_t cores[MAX_CORES];
+            smp_run(&cfg, &wl, &r, cores);
+
+            double span = r.end_time > 0 ? r.end_time : 1;
+            double lo = 100, hi = 0;
+            long long steals = 0, migrations = 0;
+            for (int c = 0; c < n; c++) {
+                double u = 100.0 * cores[c].busy_time / span;
+                if (u < lo) lo = u;
+                if (u > hi) hi = u;
+                steals += cores[c].steals;
+                migrations += cores[c].migrations;
+            }
+            int p50, p99, max, r50, r99, rmax;
+            double ta = summarize(r.turnaround, r.tasks_done, &p50, &p99, &max);
+            double ra = summarize(r.response, r.tasks_done, &r50, &r99, &rmax);
+            printf("%-5d %-14s %8.2f %4.0f-%3.0f%% %8lld %7lld %7lld | %9.1f %7d | %9.1f %7d\n", n, cfg.name,
+                   1000.0 * r.tasks_done / span, lo, hi, r.context_switches, steals, migrations, ta, p99, ra, r99);
+            sim_result_free(&r);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 7. MLFQ and CFS-style Fair Scheduling
+// ---------------------------------------------------------------------------
+// Strict priorities starve: a steady stream of high-priority work keeps
+// low-priority tasks off the CPU for as long as it lasts. Two fixes:
+//
+// MLFQ (multilevel feedback queue): it learns priority from behaviour.
+//  - Every task starts at the top level. The quantum doubles at each level down.
+//  - A task that uses up its allotment at a level is demoted. The allotment is
+//    counted across I/O, so yielding just before the slice ends does not help.
+//  - Every boost_interval ticks, ALL tasks go back to the top, so nothing waits
+//    forever. Ready lists are spliced in O(levels). Running and blocked tasks
+//    get their boost lazily, at their next enqueue or pick.
+//  - Levels map onto the bitmap ready list from section 3: O(1) pick.
+//
+// CFS-style: every task gets a share of the CPU in proportion to its weight.
+//  - vruntime = CPU time * NICE_0_WEIGHT / weight. The task with the smallest
+//    vruntime runs next: it is the one furthest behind its fair share.
+//  - Ready tasks sit in a red-black tree keyed on vruntime. The leftmost node
+//    is cached, so the pick is O(1) and the insert/erase is O(log n).
+//  - Slice = sched_latency * weight / total weight, never below min_granularity.
+//  - A waking sleeper is placed at most sched_latency / 2 behind min_vruntime.
+//    It gets a little credit, not all the time it spent asleep.
+
+// --- Red-black tree (CLRS, with a per-tree sentinel for the leaves) ---
+typedef struct {
+    RbNode_t nil;       // Shared black leaf: no NULL checks in the fixups
+    RbNode_t *root;
+    RbNode_t *leftmost; // Smallest key, cached
+} RbTree_t;
+
+typedef bool (*RbLess_t)(const RbNode_t *a, const RbNode_t *b);
+
+void rb_init(RbTree_t *tree) {
+    tree->nil.red = false;
+    tree->nil.parent = tree->nil.left = tree->nil.right = &tree->nil;
+    tree->root = &tree->nil;
+    tree->leftmost = NULL;
+}
+
+static void rb_rotate_left(RbTree_t *tree, RbNode_t *x) {
+    RbNode_t *y = x->right;
+    x->right = y->left;
+    if (y->left != &tree->nil) y->left->parent = x;
+    y->parent = x->parent;
+    if (x->parent == &tree->nil) tree->root = y;
+    else if (x == x->parent->left) x->parent->left = y;
+    else x->parent->right = y;
+    y->left = x;
+    x->parent = y;
+}
+
+static void rb_rotate_right(RbTree_t *tree, RbNode_t *x) {
+    RbNode_t *y = x->left;
+    x->left = y->right;
+    if (y->right != &tree->nil) y->right->parent = x;
+    y->parent = x->parent;
+    if (x->parent == &tree->nil) tree->root = y;
+    else if (x == x->parent->right) x->parent->right = y;
+    else x->parent->left = y;
+    y->right = x;
+    x->parent = y;
+}
+
+static RbNode_t *rb_minimum(RbTree_t *tree, RbNode_t *x) {
+    while (x->left != &tree->nil) x = x->left;
+    return x;
+}
+
+static RbNode_t *rb_next(RbTree_t *tree, RbNode_t *x) {
+    if (x->right != &tree->nil) return rb_minimum(tree, x->right);
+    RbNode_t *y = x->parent;
+    while (y != &tree->nil && x == y->right) {
+        x = y;
+        y = y->parent;
+    }
+    return (y == &tree->nil) ? NULL : y;
+}
+
+void rb_insert(RbTree_t *tree, RbNode_t *z, RbLess_t less) {
+    RbNode_t *y = &tree->nil, *x = tree->root;
+    bool leftmost = true;
+    while (x != &tree->nil) {
+        y = x;
+        if (less(z, x)) {
+            x = x->left;
+        } else {
+            x = x->right;
+            leftmost = false;
+        }
+    }
+    z->parent = y;
+    if (y == &tree->nil) tree->root = z;
+    else if (less(z, y)) y->left = z;
+    else y->right = z;
+    z->left = z->right = &tree->nil;
+    z->red = true;
+    if (leftmost) tree->leftmost = z;
+
+    // Fix a red node under a red parent
+    while (z->parent->red) {
+        RbNode_t *gp = z->parent->parent;
+        if (z->parent == gp->left) {
+            RbNode_t *uncle = gp->right;
+            if (uncle->red) {
+                z->parent->red = uncle->red = false;
+                gp->red = true;
+                z = gp;
+            } else {
+                if (z == z->parent->right) {
+                    z = z->parent;
+                    rb_rotate_left(tree, z);
+                }
+                z->parent->red = false;
+                z->parent->parent->red = true;
+                rb_rotate_right(tree, z->parent->parent);
+            }
+        } else {
+            RbNode_t *uncle = gp->left;
+            if (uncle->red) {
+                z->parent->red = uncle->red = false;
+                gp->red = true;
+                z = gp;
+            } else {
+                if (z == z->parent->left) {
+                    z = z->parent;
+                    rb_rotate_right(tree, z);
+                }
+                z->parent->red = false;
+                z->parent->parent->red = true;
+                rb_rotate_left(tree, z->parent->parent);
+            }
+        }
+    }
+    tree->root->red = false;
+}
+
+static void rb_transplant(RbTree_t *tree, RbNode_t *u, RbNode_t *v) {
+    if (u->parent == &tree->nil) tree->root = v;
+    else if (u == u->parent->left) u->parent->left = v;
+    else u->parent->right = v;
+    v->parent = u->parent;
+}
+
+void rb_erase(RbTree_t *tree, RbNode_t *z) {
+    if (tree->leftmost == z) tree->leftmost = rb_next(tree, z);
+
+    RbNode_t *y = z, *x;
+    bool removed_red = y->red;
+    if (z->left == &tree->nil) {
+        x = z->right;
+        rb_transplant(tree, z, z->right);
+    } else if (z->right == &tree->nil) {
+        x = z->left;
+        rb_transplant(tree, z, z->left);
+    } else {
+        y = rb_minimum(tree, z->right);
+        removed_red = y->red;
+        x = y->right;
+        if (y->parent == z) {
+            x->parent = y;
+        } else {
+            rb_transplant(tree, y, y->right);
+            y->right = z->right;
+            y->right->parent = y;
+        }
+        rb_transplant(tree, z, y);
+        y->left = z->left;
+        y->left->parent = y;
+        y->red = z->red;
+    }
+    if (removed_red) return;
+
+    // A black node left: push the missing black back up or rotate it in
+    while (x != tree->root && !x->red) {
+        if (x == x->parent->left) {
+            RbNode_t *w = x->parent->right;
+            if (w->red) {
+                w->red = false;
+                x->parent->red = true;
+                rb_rotate_left(tree, x->parent);
+                w = x->parent->right;
+            }
+            if (!w->left->red && !w->right->red) {
+                w->red = true;
+                x = x->parent;
+            } else {
+                if (!w->right->red) {
+                    w->left->red = false;
+                    w->red = true;
+                    rb_rotate_right(tree, w);
+                    w = x->parent->right;
+                }
+                w->red = x->parent->red;
+                x->parent->red = false;
+                w->right->red = false;
+                rb_rotate_left(tree, x->parent);
+                x = tree->root;
+            }
+        } else {
+            RbNode_t *w = x->parent->left;
+            if (w->red) {
+                w->red = false;
+                x->parent->red = true;
+                rb_rotate_right(tree, x->parent);
+                w = x->parent->left;
+            }
+            if (!w->right->red && !w->left->red) {
+                w->red = true;
+                x = x->parent;
+            } else {
+                if (!w->left->red) {
+                    w->right->red = false;
+                    w->red = true;
+                    rb_rotate_left(tree, w);
+                    w = x->parent->left;
+                }
+                w->red = x->parent->red;
+                x->parent->red = false;
+                w->left->red = false;
+                rb_rotate_right(tree, x->parent);
+                x = tree->root;
+            }
+        }
+    }
+    x->red = false;
+}
+
+// --- MLFQ ---
+#define MLFQ_LEVELS 4
+
+typedef struct {
+    int base_quantum;   // Top level; doubles at each level down
+    int boost_interval; // Ticks between priority boosts (0 = never boost)
+    int next_boost;
+    int boosts;
+} Mlfq_t;
+
+static int mlfq_quantum(const Mlfq_t *m, int level) {
+    return m->base_quantum << level;
+}
+
+// Level 0 is the top, so it maps to the HIGHEST ready-list priority
+static void mlfq_set_level(Task_t *t, int level) {
+    t->level = level;
+    t->allotment_used = 0;
+    t->priority = MLFQ_LEVELS - 1 - level;
+}
+
+static void mlfq_init(SchedPolicy_t *self) {
+    Mlfq_t *m = self->state;
+    ready_queue_init(&self->rq);
+    m->next_boost = m->boost_interval;
+    m->boosts = 0;
+}
+
+static void mlfq_check_boost(SchedPolicy_t *self, int now) {
+    Mlfq_t *m = self->state;
+    if (m->boost_interval <= 0 || now < m->next_boost) return;
+    while (m->next_boost <= now) m->next_boost += m->boost_interval;
+    m->boosts++;
+
+    // Splice every lower list onto the end of the top one
+    List_t *top = &self->rq.lists[MLFQ_LEVELS - 1];
+    for (int prio = MLFQ_LEVELS - 2; prio >= 0; prio--) {
+        List_t *l = &self->rq.lists[prio];
+        if (l->count == 0) continue;
+        if (top->tail != NULL) top->tail->next = l->head;
+        else top->head = l->head;
+        l->head->prev = top->tail;
+        top->tail = l->tail;
+        top->count += l->count;
+        list_init(l);
+    }
+    self->rq.ready_bitmap = top->count ? 1U << (MLFQ_LEVELS - 1) : 0;
+}
+
+// Tasks that missed a boost (running or blocked at the time) catch up here
+static void mlfq_apply_boost(Mlfq_t *m, Task_t *t) {
+    if (t->boost_seen != m->boosts) {
+        t->boost_seen = m->boosts;
+        mlfq_set_level(t, 0);
+    }
+}
+
+static void mlfq_enqueue(SchedPolicy_t *self, Task_t *task, EnqueueReason_t why, int now) {
+    Mlfq_t *m = self->state;
+    mlfq_check_boost(self, now);
+    if (why == ENQ_NEW) {
+        task->boost_seen = m->boosts;
+        mlfq_set_level(task, 0);
+    }
+    mlfq_apply_boost(m, task);
+    ready_queue_push(&self->rq, task, why == ENQ_PREEMPTED);
+}
+
+static Task_t *mlfq_pick(SchedPolicy_t *self, int now) {
+    mlfq_check_boost(self, now);
+    Task_t *t = ready_queue_pop_highest(&self->rq);
+    if (t != NULL) mlfq_apply_boost(self->state, t);
+    return t;
+}
+
+static int mlfq_time_slice(SchedPolicy_t *self, Task_t *task) {
+    return mlfq_quantum(self->state, task->level) - task->allotment_used;
+}
+
+static void mlfq_charge(SchedPolicy_t *self, Task_t *task, int ran, int now) {
+    (void)now;
+    Mlfq_t *m = self->state;
+    task->allotment_used += ran;
+    if (task->allotment_used >= mlfq_quantum(m, task->level)) {
+        // Used up its allotment: one level down (the bottom level just round-robins)
+        mlfq_set_level(task, task->level < MLFQ_LEVELS - 1 ? task->level + 1 : task->level);
+    }
+}
+
+// --- CFS ---
+#define NICE_0_WEIGHT 1024
+#define CFS_SCALE     1024 // vruntime is kept in 1/1024 ticks
+
+// Linux sched_prio_to_weight: each nice step is ~10% CPU, ~1.25x weight
+static const int nice_to_weight[40] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */  9548,  7620,  6100,  4904,  3906,
+    /*  -5 */  3121,  2501,  1991,  1586,  1277,
+    /*   0 */  1024,   820,   655,   526,   423,
+    /*   5 */   335,   272,   215,   172,   137,
+    /*  10 */   110,    87,    70,    56,    45,
+    /*  15 */    36,    29,    23,    18,    15,
+};
+
+typedef struct {
+    int sched_latency;   // Target period in which every ready task runs once
+    int min_granularity; // Shortest slice, so switches don't eat the CPU
+    int wakeup_granularity;
+    RbTree_t timeline;
+    long long min_vruntime;
+    long long load;      // Sum of the weights in the tree
+    int nr_queued;
+} Cfs_t;
+
+static int cfs_weight(const Task_t *t) {
+    return nice_to_weight[t->nice + 20];
+}
+
+static Task_t *timeline_task(RbNode_t *node) {
+    return (Task_t *)((char *)node - offsetof(Task_t, timeline_node));
+}
+
+static bool cfs_less(const RbNode_t *a, const RbNode_t *b) {
+    const Task_t *ta = timeline_task((RbNode_t *)a), *tb = timeline_task((RbNode_t *)b);
+    if (ta->vruntime != tb->vruntime) return ta->vruntime < tb->vruntime;
+    return ta->id < tb->id;
+}
+
+static void cfs_init(SchedPolicy_t *self) {
+    Cfs_t *cfs = self->state;
+    rb_init(&cfs->timeline);
+    cfs->min_vruntime = 0;
+    cfs->load = 0;
+    cfs->nr_queued = 0;
+}
+
+// The generator's priority 0..7 becomes nice +4..-3 (higher priority, more CPU)
+static void cfs_enqueue(SchedPolicy_t *self, Task_t *task, EnqueueReason_t why, int now) {
+    (void)now;
+    Cfs_t *cfs = self->state;
+    if (why == ENQ_NEW) {
+        task->nice = 4 - task->priority;
+        task->vruntime = cfs->min_vruntime; // Joins level with everybody else
+    } else if (why == ENQ_WOKEN) {
+        long long floor = cfs->min_vruntime - (long long)cfs->sched_latency * CFS_SCALE / 2;
+        if (task->vruntime < floor) task->vruntime = floor;
+    }
+    rb_insert(&cfs->timeline, &task->timeline_node, cfs_less);
+    cfs->load += cfs_weight(task);
+    cfs->nr_queued++;
+}
+
+static Task_t *cfs_pick(SchedPolicy_t *self, int now) {
+    (void)now;
+    Cfs_t *cfs = self->state;
+    if (cfs->timeline.leftmost == NULL) return NULL;
+    Task_t *t = timeline_task(cfs->timeline.leftmost);
+    rb_erase(&cfs->timeline, &t->timeline_node);
+    cfs->load -= cfs_weight(t);
+    cfs->nr_queued--;
+    if (t->vruntime > cfs->min_vruntime) cfs->min_vruntime = t->vruntime; // Never goes back
+    return t;
+}
+
+// Its share of the period; the period stretches once min_granularity would be undercut
+static int cfs_time_slice(SchedPolicy_t *self, Task_t *task) {
+    Cfs_t *cfs = self->state;
+    int nr = cfs->nr_queued + 1;
+    long long period = cfs->sched_latency;
+    if (nr > cfs->sched_latency / cfs->min_granularity) period = (long long)nr * cfs->min_granularity;
+    long long slice = period * cfs_weight(task) / (cfs->load + cfs_weight(task));
+    return slice < cfs->min_granularity ? cfs->min_granularity : (int)slice;
+}
+
+static void cfs_charge(SchedPolicy_t *self, Task_t *task, int ran, int now) {
+    (void)self; (void)now;
+    task->vruntime += (long long)ran * CFS_SCALE * NICE_0_WEIGHT / cfs_weight(task);
+}
+
+// Uses current's vruntime as of its dispatch, so it errs towards not preempting
+static bool cfs_preempts(SchedPolicy_t *self, Task_t *woken, Task_t *current) {
+    Cfs_t *cfs = self->state;
+    return woken->vruntime + (long long)cfs->wakeup_granularity * CFS_SCALE < current->vruntime;
+}
+
+// Interactive tasks want a quick response; batch tasks just must not starve
+static void print_class_split(const char *policy, SimResult_t *r) {
+    int *resp = malloc(r->tasks_done * sizeof(int));
+    int *turn = malloc(r->tasks_done * sizeof(int));
+    if (!resp || !turn) {
+        printf("Out of memory\n");
+        free(resp);
+        free(turn);
+        return;
+    }
+    long long ni = 0, nb = 0;
+    for (long long i = 0; i < r->tasks_done; i++) {
+        if (r->interactive[i]) resp[ni++] = r->response[i];
+        else turn[r->tasks_done - 1 - nb++] = r->turnaround[i];
+    }
+    int i50, i99, imax, b50, b99, bmax, w50, w99, wmax;
+    double im = summarize(resp, ni, &i50, &i99, &imax);
+    double bm = summarize(turn + (r->tasks_done - nb), nb, &b50, &b99, &bmax);
+    double wm = summarize(r->waiting, r->tasks_done, &w50, &w99, &wmax);
+    printf("%-9s %8lld | %7.1f %6d %7d | %7.1f %6d %7d | %7.1f %7d\n", policy, r->context_switches,
+           im, i99, imax, bm, b99, bmax, wm, wmax);
+    free(resp);
+    free(turn);
+}
+
+void run_fairness_demo(int tasks_per_trace) {
+    printf("\n--- Interactive + Batch Mix (%d tasks, ~90%% load, 8 priorities) ---\n", tasks_per_trace);
+    Mlfq_t mlfq = { .base_quantum = 2, .boost_interval = 200 };
+    Cfs_t cfs = { .sched_latency = 24, .min_granularity = 3, .wakeup_granularity = 1 };
+    SchedPolicy_t policies[] = {
+        { .name = "RR", .init = fifo_init, .enqueue = fifo_enqueue, .pick_next = fifo_pick, .slice = 4 },
+        { .name = "Priority", .init = fifo_init, .enqueue = prio_enqueue, .pick_next = prio_pick,
+          .preempts = prio_preempts },
+        { .name = "MLFQ", .init = mlfq_init, .enqueue = mlfq_enqueue, .pick_next = mlfq_pick,
+          .time_slice = mlfq_time_slice, .preempts = prio_preempts, .charge = mlfq_charge, .state = &mlfq },
+        { .name = "CFS", .init = cfs_init, .enqueue = cfs_enqueue, .pick_next = cfs_pick,
+          .time_slice = cfs_time_slice, .preempts = cfs_preempts, .charge = cfs_charge, .state = &cfs },
+    };
+    int npolicies = sizeof(policies) / sizeof(policies[0]);
+
+    printf("%-9s %8s | %-22s | %-22s | %-15s\n", "Policy", "CtxSw", "I/O resp mean/p99/max",
+           "Batch turn mean/p99/max", "Wait mean/max");
+    for (int p = 0; p < npolicies; p++) {
+        Workload_t wl = { .kind = WL_POISSON, .name = "Poisson", .count = tasks_per_trace, .mean_gap = 10,
+                          .mean_burst = 9, .io_percent = 33, .io_every = 2, .io_time = 20, .priorities = 8 };
+        workload_init(&wl, 42);
+        SimResult_t r;
+        sim_run(&policies[p], &wl, &r);
+        print_class_split(policies[p].name, &r);
+        sim_result_free(&r);
+    }
+
+    // Thousands runnable at once: groups of 5000 arrive together
+    printf("\nPick cost with thousands of runnable tasks (bursts of 5000):\n");
+    for (int p = 0; p < npolicies; p++) {
+        Workload_t wl = { .kind = WL_BURSTY, .name = "Bursty", .count = tasks_per_trace, .mean_gap = 10,
+                          .mean_burst = 9, .group_size = 5000, .io_percent = 33, .io_every = 2, .io_time = 20,
+                          .priorities = 8 };
+        workload_init(&wl, 42);
+        SimResult_t r;
+        uint64_t t0 = now_ns();
+        sim_run(&policies[p], &wl, &r);
+        double ns = (double)(now_ns() - t0);
+        printf("  %-9s %9lld events, %5.0f ns/event\n", policies[p].name, r.events, ns / r.events);
+        sim_result_free(&r);
     }
 }
 
 int main() {
     Task_t task_list[] = {
-        {1, 10, 10, 1}, // Low Prio
-        {2, 5,  5,  3}, // High Prio
-        {3, 8,  8,  2}  // Medium Prio
+        { .id = 1, .burst_time = 10, .remaining_time = 10, .priority = 1 }, // Low Prio
+        { .id = 2, .burst_time = 5,  .remaining_time = 5,  .priority = 3 }, // High Prio
+        { .id = 3, .burst_time = 8,  .remaining_time = 8,  .priority = 2 }, // Medium Prio
+        { .id = 4, .burst_time = 3,  .remaining_time = 3,  .priority = 4,   // Urgent,
+          .arrival_time = 12 }                                             // arrives late
     };
-    int count = 3;
+    int count = 4;
 
     run_fcfs(task_list, count);
     
     // Note: Array passed by reference, but we reset remaining_time inside
     run_round_robin(task_list, count, 4); // 4ms Time Slice
 
-    // Note: This sorts the array, destroying original order
+    // Task 4 arrives while Task 3 runs and preempts it
     run_priority(task_list, count);
 
+    // Generated traces instead of four hand-written tasks
+    run_policy_comparison(100000);
+    run_million_task_trace();
+
+    // Periodic task sets: priorities and guarantees computed, not guessed
+    run_schedulability_demo();
+
+    // Dual- and quad-core: where tasks are placed matters as much as the policy
+    run_smp_demo(200000);
+
+    // Mixed interactive/batch load: strict priorities starve, MLFQ and CFS don't
+    run_fairness_demo(200000);
+
     return 0;
 }
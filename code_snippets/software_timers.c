@@ -1,79 +1,371 @@
 #include <stdio.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 
 /*
  * Phase 5: Software Timers
- * 
+ *
  * Concept:
  * - Hardware Timers are scarce (maybe 3-4 per chip).
  * - Software Timers allow you to have unlimited timers.
  * - They are managed by a single system task: The "Daemon Task" (or Timer Service Task).
- * 
+ *
  * Types:
  * 1. One-Shot: Runs once, then stops. (e.g., "Turn off LED after 5s").
  * 2. Auto-Reload: Runs periodically. (e.g., "Blink LED every 1s").
+ *
+ * Hierarchical Timing Wheel (how the Daemon avoids scanning every timer):
+ * - Level 0 has 64 slots, one per tick: a timer due in < 64 ticks goes
+ *   straight into slot (expiry % 64).
+ * - Level 1 has 64 slots of 64 ticks each, Level 2 of 4096 ticks, ...
+ * - Each tick, the Daemon only looks at ONE level-0 slot: exactly the timers
+ *   due now. Every 64 ticks, one higher-level slot is "cascaded" down
+ *   (its timers are re-sorted into the finer level).
+ * - Start/Stop/Reset = link/unlink in a slot list: O(1).
+ * - Auto-reload uses "next = previous expiry + period" (not now + period),
+ *   so a late Daemon never makes the period drift.
+ *
+ * Tickless Idle (configUSE_TICKLESS_IDLE):
+ * - Most ticks do nothing. Instead of waking up for each one, ask the timer
+ *   wheel and the delayed task list "when is the NEXT thing due?"
+ * - Jump the clock straight there (like vTaskStepTick), re-sort any wheel
+ *   slots we jumped over, and process everything due at that instant.
+ * - On real HW the CPU sleeps during the jump; here the simulation just
+ *   skips the empty ticks.
  */
 
+typedef uint32_t TickType_t;
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+
 typedef enum {
     TIMER_ONE_SHOT,
     TIMER_AUTO_RELOAD
 } TimerType_t;
 
-typedef struct {
+typedef struct SoftwareTimer *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t xTimer);
+
+typedef struct SoftwareTimer {
     const char *name;
     TimerType_t type;
-    int period_ticks;
-    int remaining_ticks;
+    TickType_t period_ticks;
+    TickType_t expiry_tick;              // Absolute tick of the next expiry
     bool is_active;
-    void (*callback)(const char*);
+    void *timer_id;                      // User data (pvTimerID)
+    TimerCallbackFunction_t callback;
+    // Wheel slot list (pprev = address of the pointer that points to us -> O(1) unlink)
+    struct SoftwareTimer *next;
+    struct SoftwareTimer **pprev;
 } SoftwareTimer_t;
 
-// The Timer Service Task (Daemon) manages this list
-SoftwareTimer_t timers[2];
+#define WHEEL_BITS   6
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)            // 64 slots per level
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4                            // Range: 64^4 = 16M ticks
+#define WHEEL_MAX_DELTA (((TickType_t)1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+#define MAX_TIMERS 32768
+
+// The Timer Service Task (Daemon) owns the wheel
+typedef struct {
+    SoftwareTimer_t *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    TickType_t current_tick;
+    uint32_t expired_count;   // Callbacks run
+    uint32_t cascaded_count;  // Timers moved down a level
+    uint64_t skipped_ticks;   // Tickless: ticks jumped over
+    uint32_t wakeups;         // Tickless: times we actually woke up
+} TimerWheel_t;
+
+// Tasks blocked in vTaskDelayUntil(), sorted by wake tick (like xDelayedTaskList)
+typedef struct DelayedTask {
+    const char *name;
+    TickType_t wake_tick;
+    TickType_t period;
+    uint32_t run_count;
+    struct DelayedTask *next;
+} DelayedTask_t;
+
+static TimerWheel_t wheel;
+static SoftwareTimer_t timer_storage[MAX_TIMERS]; // Static allocation, like xTimerCreateStatic
+static int timers_created = 0;
+static DelayedTask_t *delayed_list = NULL;
+
+// --- Wheel internals ---
+
+static void wheel_link(SoftwareTimer_t *t) {
+    TickType_t delta = t->expiry_tick - wheel.current_tick;
+    if ((int32_t)delta < 0) delta = 0;            // Overdue: treat as due now
+    if (delta > WHEEL_MAX_DELTA) delta = WHEEL_MAX_DELTA; // Re-sorted when it cascades
+
+    // Pick the finest level whose range covers the delta
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= ((TickType_t)1 << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    TickType_t when = wheel.current_tick + delta;
+    int slot = (when >> (WHEEL_BITS * level)) & WHEEL_MASK;
+
+    SoftwareTimer_t **head = &wheel.slots[level][slot];
+    t->next = *head;
+    if (*head != NULL) (*head)->pprev = &t->next;
+    *head = t;
+    t->pprev = head;
+}
+
+static void wheel_unlink(SoftwareTimer_t *t) {
+    if (t->pprev == NULL) return; // Not in the wheel
+    *t->pprev = t->next;
+    if (t->next != NULL) t->next->pprev = t->pprev;
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+// Re-sort one coarse slot into finer levels
+static void wheel_cascade(int level, int slot) {
+    SoftwareTimer_t *t = wheel.slots[level][slot];
+    wheel.slots[level][slot] = NULL;
+    while (t != NULL) {
+        SoftwareTimer_t *next = t->next;
+        wheel_link(t);
+        wheel.cascaded_count++;
+        t = next;
+    }
+}
+
+// Earliest expiry in the wheel. Returns false if no timer is running.
+static bool wheel_next_expiry(TickType_t *next_tick) {
+    bool found = false;
+    TickType_t best = 0;
+
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        int shift = WHEEL_BITS * level;
+        // Walk this level's slots in time order; the first non-empty one holds its earliest timers.
+        // Not on the top level: timers beyond WHEEL_MAX_DELTA are clipped into it, so a slot there
+        // can hold a timer due long after the timers in the slots behind it. Check them all.
+        bool top = (level == WHEEL_LEVELS - 1);
+        for (int k = (level == 0) ? 0 : 1; k <= WHEEL_SLOTS; k++) {
+            int slot = ((wheel.current_tick >> shift) + k) & WHEEL_MASK;
+            SoftwareTimer_t *t = wheel.slots[level][slot];
+            if (t == NULL) continue;
+            for (; t != NULL; t = t->next) {
+                if (!found || (int32_t)(t->expiry_tick - best) < 0) best = t->expiry_tick;
+                found = true;
+            }
+            if (!top) break;
+        }
+    }
+
+    *next_tick = best;
+    return found;
+}
+
+// Move the clock to 'target' in one step. Only valid if nothing is due before it.
+static void wheel_jump_to(TickType_t target) {
+    TickType_t from = wheel.current_tick;
+    wheel.current_tick = target;
+
+    // Any coarse slot whose cascade point we jumped over must be re-sorted now
+    for (int level = WHEEL_LEVELS - 1; level >= 1; level--) {
+        int shift = WHEEL_BITS * level;
+        TickType_t crossed = (target >> shift) - (from >> shift);
+        if (crossed > WHEEL_SLOTS) crossed = WHEEL_SLOTS;
+        for (TickType_t k = 1; k <= crossed; k++) {
+            wheel_cascade(level, ((from >> shift) + k) & WHEEL_MASK);
+        }
+    }
+}
+
+// --- FreeRTOS-style API ---
+
+TimerHandle_t xTimerCreate(const char *pcTimerName, TickType_t xTimerPeriod, bool uxAutoReload,
+                           void *pvTimerID, TimerCallbackFunction_t pxCallbackFunction) {
+    if (timers_created == MAX_TIMERS || xTimerPeriod == 0) return NULL;
+    SoftwareTimer_t *t = &timer_storage[timers_created++];
+    memset(t, 0, sizeof(*t));
+    t->name = pcTimerName;
+    t->type = uxAutoReload ? TIMER_AUTO_RELOAD : TIMER_ONE_SHOT;
+    t->period_ticks = xTimerPeriod;
+    t->timer_id = pvTimerID;
+    t->callback = pxCallbackFunction;
+    return t;
+}
+
+// Start (or restart) the timer: expires 'period' ticks from now
+bool xTimerStart(TimerHandle_t xTimer) {
+    wheel_unlink(xTimer);
+    xTimer->expiry_tick = wheel.current_tick + xTimer->period_ticks;
+    xTimer->is_active = true;
+    wheel_link(xTimer);
+    return true;
+}
+
+bool xTimerStop(TimerHandle_t xTimer) {
+    wheel_unlink(xTimer);
+    xTimer->is_active = false;
+    return true;
+}
+
+// Same as FreeRTOS: Reset re-arms from now, even if the timer was stopped
+bool xTimerReset(TimerHandle_t xTimer) {
+    return xTimerStart(xTimer);
+}
+
+// Same as FreeRTOS: changing the period also (re)starts the timer
+bool xTimerChangePeriod(TimerHandle_t xTimer, TickType_t xNewPeriod) {
+    if (xNewPeriod == 0) return false;
+    xTimer->period_ticks = xNewPeriod;
+    return xTimerStart(xTimer);
+}
+
+bool xTimerIsTimerActive(TimerHandle_t xTimer) { return xTimer->is_active; }
+const char *pcTimerGetName(TimerHandle_t xTimer) { return xTimer->name; }
+void *pvTimerGetTimerID(TimerHandle_t xTimer) { return xTimer->timer_id; }
 
-void my_timer_callback(const char *name) {
-    printf("[Timer Callback] %s fired!\n", name);
+void my_timer_callback(TimerHandle_t xTimer) {
+    printf("[Timer Callback] %s fired!\n", pcTimerGetName(xTimer));
+    if (!xTimerIsTimerActive(xTimer)) {
+        printf("[Timer System] %s stopped.\n", pcTimerGetName(xTimer));
+    }
 }
 
+TimerHandle_t backlight_timer;
+TimerHandle_t heartbeat_timer;
+
 void create_timers() {
     // Timer 1: One-Shot (Backlight off after 3 ticks)
-    timers[0].name = "BacklightTimer";
-    timers[0].type = TIMER_ONE_SHOT;
-    timers[0].period_ticks = 3;
-    timers[0].remaining_ticks = 3;
-    timers[0].is_active = true;
-    timers[0].callback = my_timer_callback;
+    backlight_timer = xTimerCreate("BacklightTimer", 3, false, NULL, my_timer_callback);
 
     // Timer 2: Auto-Reload (Heartbeat every 2 ticks)
-    timers[1].name = "HeartbeatTimer";
-    timers[1].type = TIMER_AUTO_RELOAD;
-    timers[1].period_ticks = 2;
-    timers[1].remaining_ticks = 2;
-    timers[1].is_active = true;
-    timers[1].callback = my_timer_callback;
+    heartbeat_timer = xTimerCreate("HeartbeatTimer", 2, true, NULL, my_timer_callback);
+
+    xTimerStart(backlight_timer);
+    xTimerStart(heartbeat_timer);
 }
 
 // Simulate the Daemon Task processing the timers
 void process_timers_tick() {
-    for (int i = 0; i < 2; i++) {
-        if (timers[i].is_active) {
-            timers[i].remaining_ticks--;
-            
-            if (timers[i].remaining_ticks == 0) {
-                // Timer Expired! Call the callback.
-                timers[i].callback(timers[i].name);
-                
-                // Logic for Type
-                if (timers[i].type == TIMER_AUTO_RELOAD) {
-                    timers[i].remaining_ticks = timers[i].period_ticks; // Reload
-                } else {
-                    timers[i].is_active = false; // Stop
-                    printf("[Timer System] %s stopped.\n", timers[i].name);
-                }
-            }
+    wheel.current_tick++;
+
+    // Every 64 ticks: pull the next coarse slot down (and the level above, every 4096...)
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        if (((wheel.current_tick >> (WHEEL_BITS * (level - 1))) & WHEEL_MASK) != 0) break;
+        wheel_cascade(level, (wheel.current_tick >> (WHEEL_BITS * level)) & WHEEL_MASK);
+    }
+
+    // Only the timers in THIS slot are touched
+    int slot = wheel.current_tick & WHEEL_MASK;
+    SoftwareTimer_t *t;
+    while ((t = wheel.slots[0][slot]) != NULL) {
+        wheel_unlink(t);
+
+        // Timer Expired! Call the callback.
+        wheel.expired_count++;
+        if (t->type == TIMER_AUTO_RELOAD) {
+            t->expiry_tick += t->period_ticks; // Reload from the due time: no drift
+            wheel_link(t);                     // Always lands in a later slot
+        } else {
+            t->is_active = false; // Stop
         }
+        t->callback(t);
+    }
+}
+
+// --- Delayed tasks (what xTaskIncrementTick checks every tick) ---
+
+static void delayed_list_insert(DelayedTask_t *task) {
+    DelayedTask_t **pp = &delayed_list;
+    while (*pp != NULL && (int32_t)((*pp)->wake_tick - task->wake_tick) <= 0) {
+        pp = &(*pp)->next;
+    }
+    task->next = *pp;
+    *pp = task;
+}
+
+// Periodic task blocked in vTaskDelayUntil(&last_wake, period)
+void vTaskDelayUntilSim(DelayedTask_t *task, const char *name, TickType_t period) {
+    task->name = name;
+    task->period = period;
+    task->wake_tick = wheel.current_tick + period;
+    task->run_count = 0;
+    delayed_list_insert(task);
+}
+
+// Take the task off the delayed list (vTaskSuspend)
+void vTaskSuspendSim(DelayedTask_t *task) {
+    DelayedTask_t **pp = &delayed_list;
+    while (*pp != NULL && *pp != task) pp = &(*pp)->next;
+    if (*pp != NULL) *pp = task->next;
+}
+
+// Unblock every task whose wake time has come (the list is sorted: stop at the first future one)
+void process_delayed_tasks() {
+    while (delayed_list != NULL && (int32_t)(delayed_list->wake_tick - wheel.current_tick) <= 0) {
+        DelayedTask_t *task = delayed_list;
+        delayed_list = task->next;
+        task->run_count++;                // "Task runs" then delays again
+        task->wake_tick += task->period;  // DelayUntil: fixed rate, no drift
+        delayed_list_insert(task);
+    }
+}
+
+// Ticks from now until 'when' (0 if it is already overdue)
+static TickType_t ticks_until(TickType_t when) {
+    TickType_t delta = when - wheel.current_tick;
+    return ((int32_t)delta < 0) ? 0 : delta;
+}
+
+// Ticks until the next timer expiry or task unblock (portMAX_DELAY if nothing is pending)
+TickType_t xGetExpectedIdleTime() {
+    TickType_t next;
+    TickType_t idle = portMAX_DELAY;
+
+    if (wheel_next_expiry(&next)) {
+        idle = ticks_until(next);
     }
+    if (delayed_list != NULL && ticks_until(delayed_list->wake_tick) < idle) {
+        idle = ticks_until(delayed_list->wake_tick);
+    }
+    return idle;
+}
+
+// Sleep until the next event (but not past 'end_tick'), then process it.
+// Returns the number of empty ticks that were skipped.
+TickType_t process_ticks_tickless(TickType_t end_tick) {
+    TickType_t idle = xGetExpectedIdleTime();
+    TickType_t max_idle = end_tick - wheel.current_tick;
+    if (max_idle == 0) return 0;
+    if (idle == 0) idle = 1; // Something is overdue: no sleep, just run the next tick
+    if (idle > max_idle) idle = max_idle;
+
+    TickType_t skipped = idle - 1;
+    wheel_jump_to(wheel.current_tick + skipped); // Nothing happens in these ticks
+    process_timers_tick();                       // The tick where something IS due
+    process_delayed_tasks();
+
+    wheel.skipped_ticks += skipped;
+    wheel.wakeups++;
+    return skipped;
+}
+
+// --- Scale test: many protocol timeouts ---
+static uint32_t timeout_hits = 0;
+
+void timeout_callback(TimerHandle_t xTimer) {
+    (void)xTimer;
+    timeout_hits++;
+}
+
+static uint32_t heartbeat_hits = 0;
+
+void heartbeat_callback(TimerHandle_t xTimer) {
+    (void)xTimer;
+    heartbeat_hits++;
+}
+
+void watchdog_callback(TimerHandle_t xTimer) {
+    printf("[Timer Callback] %s fired at tick %u (day %.2f)\n",
+           pcTimerGetName(xTimer), wheel.current_tick, wheel.current_tick / 86400000.0);
 }
 
 int main() {
@@ -84,7 +376,72 @@ int main() {
     for (int tick = 1; tick <= 10; tick++) {
         printf("\n--- Tick %d ---\n", tick);
         process_timers_tick();
+
+        if (tick == 6) {
+            printf("[App] xTimerChangePeriod(HeartbeatTimer, 3)\n");
+            xTimerChangePeriod(heartbeat_timer, 3);
+        }
     }
+    xTimerStop(heartbeat_timer);
+
+    printf("\n=== Tickless Idle: 7 Days of Uptime (1 tick = 1 ms) ===\n");
+    TimerHandle_t hb = xTimerCreate("Heartbeat1s", 1000, true, NULL, heartbeat_callback);
+    TimerHandle_t wd = xTimerCreate("Maintenance3d", 3u * 86400000u, false, NULL, watchdog_callback);
+    xTimerStart(hb);
+    xTimerStart(wd);
+    DelayedTask_t sensor_task;
+    vTaskDelayUntilSim(&sensor_task, "SensorTask", 60000); // Wakes once a minute
+
+    TickType_t start_tick = wheel.current_tick;
+    TickType_t end_tick = start_tick + 7u * 86400000u;
+    while (wheel.current_tick != end_tick) {
+        process_ticks_tickless(end_tick);
+    }
+    xTimerStop(hb);
+
+    printf("Simulated %u ticks with %u wakeups (%llu ticks skipped).\n",
+           end_tick - start_tick, wheel.wakeups, (unsigned long long)wheel.skipped_ticks);
+    printf("Heartbeat fired %u times, %s ran %u times.\n",
+           heartbeat_hits, sensor_task.name, sensor_task.run_count);
+
+    printf("\n=== Tickless Idle: Near Timer Started Behind a Far One ===\n");
+    vTaskSuspendSim(&sensor_task); // Nothing else pending: the wheel alone decides the idle time
+    // The far timer is beyond the wheel's range, so it is parked in the top level.
+    // The idle time must still come from the near timer started later.
+    TimerHandle_t far_timer = xTimerCreate("Far300M", 300000000u, false, NULL, watchdog_callback);
+    TimerHandle_t near_timer = xTimerCreate("Near12.6M", 12600000u, false, NULL, watchdog_callback);
+    TickType_t base_tick = wheel.current_tick;
+    xTimerStart(far_timer);
+    while (wheel.current_tick != base_tick + 8400000u) {
+        process_ticks_tickless(base_tick + 8400000u);
+    }
+    xTimerStart(near_timer);
+    printf("At tick %u: expected idle %u ticks (near timer due at tick %u)\n",
+           wheel.current_tick, xGetExpectedIdleTime(), near_timer->expiry_tick);
+    while (xTimerIsTimerActive(far_timer) || xTimerIsTimerActive(near_timer)) {
+        process_ticks_tickless(base_tick + 400000000u);
+    }
+
+    printf("\n=== Timing Wheel Scale Test ===\n");
+    int count = 20000;
+    uint32_t seed = 12345;
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345; // Simple LCG for repeatable periods
+        TickType_t period = 1 + (seed >> 16) % 5000;
+        TimerHandle_t t = xTimerCreate("Timeout", period, (i % 4) == 0, NULL, timeout_callback);
+        xTimerStart(t);
+    }
+
+    uint32_t expired_before = wheel.expired_count;
+    uint32_t cascaded_before = wheel.cascaded_count;
+    int ticks = 100000;
+    for (int i = 0; i < ticks; i++) process_timers_tick();
+
+    uint32_t cascaded = wheel.cascaded_count - cascaded_before;
+    printf("%d timers, %d ticks: %u callbacks, %u cascade moves.\n",
+           count, ticks, timeout_hits, cascaded);
+    printf("Timers touched per tick: %.2f (a linear scan would touch %d)\n",
+           (double)(wheel.expired_count - expired_before + cascaded) / ticks, count);
 
     return 0;
 }
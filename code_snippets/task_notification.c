@@ -1,75 +1,452 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 
 /*
  * Phase 4 Missing Topic: Task Notifications vs Semaphores
- * 
+ *
  * Scenario: An ISR needs to wake up a Task.
  * Method 1: Binary Semaphore (Standard, heavier).
  * Method 2: Task Notification (Faster, lighter).
+ *
+ * How notifications work (like FreeRTOS xTaskGenericNotify):
+ * - Every TCB carries an ARRAY of notification slots: a 32-bit value plus a
+ *   state (NotWaiting / Waiting / Received). Index 0 is the "default" one,
+ *   other indexes let one task have several independent channels.
+ * - The sender picks what happens to the value (eAction):
+ *   eIncrement -> counting semaphore, eSetBits -> event group,
+ *   eSetValueWithOverwrite -> mailbox, eSetValueWithoutOverwrite -> mailbox
+ *   that refuses to lose an unread value.
+ * - The receiver BLOCKS (with timeout) in ulTaskNotifyTake() (semaphore style)
+ *   or xTaskNotifyWait() (value/bits style).
+ * - A semaphore is a separate object with its own wait list: giving it means
+ *   touching that object AND a list. A notification writes straight into the
+ *   TCB, and the only possible waiter is the task itself.
  */
 
+typedef uint32_t TickType_t;
+#define portMAX_DELAY 0xFFFFFFFFu
+
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES 3
+
+// Notify state per slot
+#define taskNOT_WAITING_NOTIFICATION  0
+#define taskWAITING_NOTIFICATION      1
+#define taskNOTIFICATION_RECEIVED     2
+
+typedef enum {
+    eNoAction = 0,              // Just wake the task, value untouched
+    eSetBits,                   // value |= ulValue
+    eIncrement,                 // value++ (ulValue ignored)
+    eSetValueWithOverwrite,     // value = ulValue
+    eSetValueWithoutOverwrite   // value = ulValue, unless the last one wasn't read yet
+} eNotifyAction;
+
+typedef enum { WAIT_NONE, WAIT_SEMAPHORE, WAIT_TAKE, WAIT_NOTIFY } WaitKind_t;
+
+static bool verbose = true; // Off while benchmarking
+#define LOG(...) do { if (verbose) printf(__VA_ARGS__); } while (0)
+
+static TickType_t current_tick = 0;
+
+// Both paths pay for the same critical section (interrupt mask on a real MCU)
+static volatile int critical_nesting = 0;
+#define taskENTER_CRITICAL() (critical_nesting++)
+#define taskEXIT_CRITICAL()  (critical_nesting--)
+
+// Simulated TCB: the notification array lives INSIDE it (no extra object)
+typedef struct TCB_Stub {
+    const char *name;
+    int priority;
+    uint32_t ulNotifiedValue[configTASK_NOTIFICATION_ARRAY_ENTRIES];
+    uint8_t ucNotifyState[configTASK_NOTIFICATION_ARRAY_ENTRIES];
+
+    // Blocking state (what the task is waiting for)
+    bool is_blocked;
+    WaitKind_t wait_kind;
+    TickType_t wake_tick;
+    bool wait_forever;            // portMAX_DELAY: wake_tick is unused
+    int wait_index;               // Notification slot being waited on
+    bool clear_count_on_exit;     // ulTaskNotifyTake
+    uint32_t bits_to_clear_on_exit; // xTaskNotifyWait
+    struct TCB_Stub *wait_next;   // Link in a semaphore wait list
+
+    // Result of the last blocking call (filled in when the task wakes)
+    bool result_ok;
+    uint32_t result_value;
+} TCB_Stub_t;
+
+static void make_ready(TCB_Stub_t *task) {
+    task->is_blocked = false;
+    task->wait_kind = WAIT_NONE;
+    LOG("[OS] Task '%s' UNBLOCKED.\n", task->name);
+}
+
+static void block(TCB_Stub_t *task, WaitKind_t kind, TickType_t ticks_to_wait) {
+    task->is_blocked = true;
+    task->wait_kind = kind;
+    task->wait_forever = (ticks_to_wait == portMAX_DELAY);
+    task->wake_tick = current_tick + ticks_to_wait; // May wrap; compared wrap-safe
+    LOG("[OS] Task '%s' BLOCKED.\n", task->name);
+}
+
 // --- Method 1: Binary Semaphore ---
+// A separate kernel object. In FreeRTOS it IS a queue with item size 0:
+// the count is "messages waiting", and it has both queue wait lists.
 typedef struct {
-    bool token;
+    uint8_t *storage;             // Unused for semaphores (item size 0)
+    size_t item_size;
+    uint32_t count;               // uxMessagesWaiting
+    uint32_t max_count;           // uxLength: 1 = binary
+    TCB_Stub_t *waiting_to_take;  // xTasksWaitingToReceive, highest priority first
+    TCB_Stub_t *waiting_to_give;  // xTasksWaitingToSend (never used by a give from ISR)
+    int8_t rx_lock;               // Queue locks: while a task is being placed on a
+    int8_t tx_lock;               // wait list, ISRs must not touch the lists
 } Semaphore_t;
 
-Semaphore_t my_sem = { .token = false };
+#define queueUNLOCKED         (-1)
+#define queueLOCKED_UNMODIFIED 0
+
+Semaphore_t my_sem = { .count = 0, .max_count = 1, .rx_lock = queueUNLOCKED, .tx_lock = queueUNLOCKED };
+
+// Event list insert, sorted by priority like vListInsert()
+static void event_list_insert(TCB_Stub_t **list, TCB_Stub_t *task) {
+    while (*list != NULL && (*list)->priority >= task->priority) list = &(*list)->wait_next;
+    task->wait_next = *list;
+    *list = task;
+}
+
+static void event_list_remove(TCB_Stub_t **list, TCB_Stub_t *task) {
+    while (*list != task) list = &(*list)->wait_next;
+    *list = task->wait_next;
+    task->wait_next = NULL;
+}
+
+// Wake the highest-priority taker; it takes the token as it resumes
+static void wake_one_taker(Semaphore_t *sem) {
+    TCB_Stub_t *task = sem->waiting_to_take;
+    if (task == NULL) return;
+    event_list_remove(&sem->waiting_to_take, task);
+    sem->count--;
+    task->result_ok = true;
+    make_ready(task);
+}
+
+// Returns true if taken now; false if the task blocked or the poll failed
+bool xSemaphoreTake(Semaphore_t *sem, TCB_Stub_t *task, TickType_t ticks_to_wait) {
+    taskENTER_CRITICAL();
+    if (sem->count > 0) {
+        sem->count--;             // "Receive" a zero-byte item
+        taskEXIT_CRITICAL();
+        task->result_ok = true;
+        return true;
+    }
+    if (ticks_to_wait == 0) {
+        taskEXIT_CRITICAL();
+        task->result_ok = false;
+        return false;
+    }
+    taskEXIT_CRITICAL();
+
+    // Lock the queue, join its wait list, then unlock and replay any ISR gives
+    sem->rx_lock = queueLOCKED_UNMODIFIED;
+    sem->tx_lock = queueLOCKED_UNMODIFIED;
+    event_list_insert(&sem->waiting_to_take, task);
+    block(task, WAIT_SEMAPHORE, ticks_to_wait);
+    taskENTER_CRITICAL();
+    for (int8_t pending = sem->tx_lock; pending > 0; pending--) wake_one_taker(sem);
+    sem->tx_lock = queueUNLOCKED;
+    sem->rx_lock = queueUNLOCKED;
+    taskEXIT_CRITICAL();
+    return false;
+}
+
+bool xSemaphoreGiveFromISR(Semaphore_t *sem) {
+    taskENTER_CRITICAL();
+    if (sem->count >= sem->max_count) { // Binary: already given
+        taskEXIT_CRITICAL();
+        return false;
+    }
+    sem->count++;                 // "Send" a zero-byte item
+    if (sem->tx_lock == queueUNLOCKED) wake_one_taker(sem);
+    else sem->tx_lock++;          // The task that unlocks the queue does the wake
+    taskEXIT_CRITICAL();
+    return true;
+}
 
 void ISR_Give_Semaphore() {
-    my_sem.token = true;
-    printf("[ISR] Gave Semaphore.\n");
+    xSemaphoreGiveFromISR(&my_sem);
+    LOG("[ISR] Gave Semaphore.\n");
 }
 
-void Task_Take_Semaphore() {
-    if (my_sem.token) {
-        my_sem.token = false;
-        printf("[Task] Took Semaphore. Processing...\n");
+void Task_Take_Semaphore(TCB_Stub_t *task) {
+    if (xSemaphoreTake(&my_sem, task, portMAX_DELAY)) {
+        LOG("[Task] Took Semaphore. Processing...\n");
     } else {
-        printf("[Task] Blocked waiting for Semaphore.\n");
+        LOG("[Task] Blocked waiting for Semaphore.\n");
     }
 }
 
 // --- Method 2: Task Notification ---
-// Inside the TCB, there is ALREADY a 32-bit value.
-typedef struct {
-    uint32_t ulNotifiedValue;
-    uint8_t ucNotifyState; // 0=NotWaiting, 1=Waiting, 2=Notified
-} TCB_Stub_t;
+// Inside the TCB, there is ALREADY an array of 32-bit values.
+
+// Returns true on success; false only for eSetValueWithoutOverwrite on an unread value
+bool xTaskGenericNotify(TCB_Stub_t *task, int index, uint32_t ulValue, eNotifyAction eAction,
+                        uint32_t *pulPreviousValue) {
+    taskENTER_CRITICAL();
+    if (pulPreviousValue != NULL) *pulPreviousValue = task->ulNotifiedValue[index];
+
+    uint8_t original_state = task->ucNotifyState[index];
+    task->ucNotifyState[index] = taskNOTIFICATION_RECEIVED;
+
+    switch (eAction) {
+    case eNoAction:
+        break;
+    case eSetBits:
+        task->ulNotifiedValue[index] |= ulValue;
+        break;
+    case eIncrement:
+        task->ulNotifiedValue[index]++; // Can be used as a counter!
+        break;
+    case eSetValueWithOverwrite:
+        task->ulNotifiedValue[index] = ulValue;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (original_state == taskNOTIFICATION_RECEIVED) { // Previous value not read yet
+            taskEXIT_CRITICAL();
+            return false;
+        }
+        task->ulNotifiedValue[index] = ulValue;
+        break;
+    }
+
+    // Direct to Task! The only possible waiter is the task itself.
+    if (original_state == taskWAITING_NOTIFICATION && task->is_blocked && task->wait_index == index) {
+        uint32_t value = task->ulNotifiedValue[index];
+        bool ok = true;
+        if (task->wait_kind == WAIT_TAKE) {
+            // eNoAction / eSetBits 0 wake the task without giving it a count:
+            // like ulTaskNotifyTake, only touch a non-zero value
+            ok = (value != 0);
+            if (ok) task->ulNotifiedValue[index] = task->clear_count_on_exit ? 0 : value - 1;
+        } else {
+            task->ulNotifiedValue[index] &= ~task->bits_to_clear_on_exit;
+        }
+        task->ucNotifyState[index] = taskNOT_WAITING_NOTIFICATION;
+        task->result_ok = ok;
+        task->result_value = value;
+        make_ready(task);
+    }
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+bool xTaskNotifyGive(TCB_Stub_t *task) {
+    return xTaskGenericNotify(task, 0, 0, eIncrement, NULL);
+}
+
+// Semaphore-style wait. Returns the count (before clear/decrement), 0 = nothing yet.
+// If the task blocks, the count arrives later in task->result_value.
+uint32_t ulTaskNotifyTakeIndexed(TCB_Stub_t *task, int index, bool clear_count_on_exit,
+                                 TickType_t ticks_to_wait) {
+    taskENTER_CRITICAL();
+    uint32_t value = task->ulNotifiedValue[index];
+    if (value == 0) {
+        task->result_ok = false;
+        task->result_value = 0;
+        if (ticks_to_wait != 0) {
+            task->ucNotifyState[index] = taskWAITING_NOTIFICATION;
+            task->wait_index = index;
+            task->clear_count_on_exit = clear_count_on_exit;
+            block(task, WAIT_TAKE, ticks_to_wait);
+        }
+        taskEXIT_CRITICAL();
+        return 0;
+    }
 
-TCB_Stub_t my_task_tcb = { .ulNotifiedValue = 0, .ucNotifyState = 0 };
+    // Binary semaphore (clear) or counting semaphore (decrement)
+    task->ulNotifiedValue[index] = clear_count_on_exit ? 0 : value - 1;
+    task->ucNotifyState[index] = taskNOT_WAITING_NOTIFICATION;
+    taskEXIT_CRITICAL();
+    task->result_ok = true;
+    task->result_value = value;
+    return value;
+}
+
+// Value/bits-style wait. Returns true if a notification was received; value in *pulNotificationValue.
+// If the task blocks it returns false and the outcome arrives later in result_ok / result_value.
+bool xTaskNotifyWaitIndexed(TCB_Stub_t *task, int index, uint32_t bits_to_clear_on_entry,
+                            uint32_t bits_to_clear_on_exit, uint32_t *pulNotificationValue,
+                            TickType_t ticks_to_wait) {
+    taskENTER_CRITICAL();
+    if (task->ucNotifyState[index] != taskNOTIFICATION_RECEIVED) {
+        task->ulNotifiedValue[index] &= ~bits_to_clear_on_entry;
+        task->result_ok = false;
+        if (ticks_to_wait == 0) {
+            if (pulNotificationValue != NULL) *pulNotificationValue = task->ulNotifiedValue[index];
+        } else {
+            task->ucNotifyState[index] = taskWAITING_NOTIFICATION;
+            task->wait_index = index;
+            task->bits_to_clear_on_exit = bits_to_clear_on_exit;
+            block(task, WAIT_NOTIFY, ticks_to_wait);
+        }
+        taskEXIT_CRITICAL();
+        return false;
+    }
+
+    uint32_t value = task->ulNotifiedValue[index];
+    if (pulNotificationValue != NULL) *pulNotificationValue = value;
+    task->ulNotifiedValue[index] &= ~bits_to_clear_on_exit;
+    task->ucNotifyState[index] = taskNOT_WAITING_NOTIFICATION;
+    taskEXIT_CRITICAL();
+    task->result_ok = true;
+    task->result_value = value;
+    return true;
+}
+
+// Tick interrupt: time out a blocked task
+void task_tick(TCB_Stub_t *task, Semaphore_t *sem) {
+    current_tick++;
+    if (!task->is_blocked || task->wait_forever) return;
+    if ((int32_t)(current_tick - task->wake_tick) < 0) return; // Not yet (wrap-safe)
+
+    if (task->wait_kind == WAIT_SEMAPHORE) {
+        event_list_remove(&sem->waiting_to_take, task);
+    } else {
+        task->ucNotifyState[task->wait_index] = taskNOT_WAITING_NOTIFICATION;
+        task->result_value = task->ulNotifiedValue[task->wait_index];
+    }
+    task->result_ok = false;
+    LOG("[OS] Task '%s' timed out.\n", task->name);
+    make_ready(task);
+}
+
+TCB_Stub_t my_task_tcb = { .name = "Worker" };
 
 void ISR_Notify_Task() {
-    // Direct to Task! No intermediate object.
-    my_task_tcb.ulNotifiedValue++; // Can be used as a counter!
-    my_task_tcb.ucNotifyState = 2; // Set to "Notified"
-    printf("[ISR] Sent Notification to Task TCB. (Value: %d)\n", my_task_tcb.ulNotifiedValue);
+    xTaskNotifyGive(&my_task_tcb);
+    LOG("[ISR] Sent Notification to Task TCB. (Value: %u)\n", my_task_tcb.ulNotifiedValue[0]);
 }
 
 void Task_Wait_Notification() {
-    if (my_task_tcb.ucNotifyState == 2) {
-        uint32_t val = my_task_tcb.ulNotifiedValue;
-        my_task_tcb.ucNotifyState = 0; // Clear state
-        // Optional: Clear value or keep it (Counting Semaphore behavior)
-        my_task_tcb.ulNotifiedValue = 0; 
-        printf("[Task] Received Notification! Value was: %d\n", val);
+    uint32_t val = ulTaskNotifyTakeIndexed(&my_task_tcb, 0, true, portMAX_DELAY);
+    if (val != 0) {
+        LOG("[Task] Received Notification! Value was: %u\n", val);
     } else {
-        printf("[Task] Blocked waiting for Notification.\n");
+        LOG("[Task] Blocked waiting for Notification.\n");
+    }
+}
+
+// --- Benchmark: ISR -> blocked task, semaphore vs notification ---
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#define BENCH_ITERATIONS 5000000
+
+void run_benchmark() {
+    TCB_Stub_t task = { .name = "Bench" };
+    Semaphore_t sem = { .count = 0, .max_count = 1, .rx_lock = queueUNLOCKED, .tx_lock = queueUNLOCKED };
+    uint64_t checksum = 0;
+    verbose = false;
+
+    // Each iteration: task blocks, "ISR" signals, task wakes and consumes
+    uint64_t start = now_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        xSemaphoreTake(&sem, &task, portMAX_DELAY);
+        xSemaphoreGiveFromISR(&sem);
+        checksum += task.result_ok;
+    }
+    uint64_t sem_ns = now_ns() - start;
+
+    start = now_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        ulTaskNotifyTakeIndexed(&task, 0, true, portMAX_DELAY);
+        xTaskNotifyGive(&task);
+        checksum += task.result_ok;
+    }
+    uint64_t notify_ns = now_ns() - start;
+
+    // Same again, but the signal arrives BEFORE the task asks (no blocking)
+    start = now_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        xSemaphoreGiveFromISR(&sem);
+        checksum += xSemaphoreTake(&sem, &task, portMAX_DELAY);
     }
+    uint64_t sem_fast_ns = now_ns() - start;
+
+    start = now_ns();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        xTaskNotifyGive(&task);
+        checksum += ulTaskNotifyTakeIndexed(&task, 0, true, portMAX_DELAY);
+    }
+    uint64_t notify_fast_ns = now_ns() - start;
+    verbose = true;
+
+    printf("%d signals each (checksum %llu)\n", BENCH_ITERATIONS, (unsigned long long)checksum);
+    printf("%-28s %12s %12s\n", "", "Semaphore", "Notification");
+    printf("%-28s %9.1f ns %9.1f ns\n", "Give -> blocked task wakes",
+           (double)sem_ns / BENCH_ITERATIONS, (double)notify_ns / BENCH_ITERATIONS);
+    printf("%-28s %9.1f ns %9.1f ns\n", "Give then take (no block)",
+           (double)sem_fast_ns / BENCH_ITERATIONS, (double)notify_fast_ns / BENCH_ITERATIONS);
+    printf("%-28s %9zu B  %9zu B\n", "RAM per signal channel",
+           sizeof(Semaphore_t), sizeof(uint32_t) + sizeof(uint8_t));
+    printf("(The semaphore is a whole extra object; a notification slot is a value + state\n"
+           " already inside the TCB. In FreeRTOS a semaphore is a queue: ~80 bytes on 32-bit.\n"
+           " The blocking path is where the semaphore pays: queue lock + wait list insert/remove.)\n");
 }
 
 int main() {
+    TCB_Stub_t *task = &my_task_tcb;
+
     printf("=== 1. Binary Semaphore (Object-based) ===\n");
-    Task_Take_Semaphore(); // Fails
+    Task_Take_Semaphore(task); // Blocks
+    ISR_Give_Semaphore();      // Wakes it directly
+    Task_Take_Semaphore(task); // Nothing left: blocks again
+    task_tick(task, &my_sem);  // (still waiting forever)
     ISR_Give_Semaphore();
-    Task_Take_Semaphore(); // Succeeds
 
     printf("\n=== 2. Task Notification (Direct-to-Task) ===\n");
-    Task_Wait_Notification(); // Fails
+    Task_Wait_Notification(); // Blocks
+    ISR_Notify_Task();        // Wakes it (and the count is consumed right away)
     ISR_Notify_Task();
     ISR_Notify_Task(); // Note: It counts! (Value becomes 2)
-    Task_Wait_Notification(); // Succeeds
+    Task_Wait_Notification(); // Succeeds at once
+
+    printf("\n=== 3. eAction Modes ===\n");
+    uint32_t value = 0;
+    xTaskGenericNotify(task, 1, 0x01, eSetBits, NULL);
+    xTaskGenericNotify(task, 1, 0x04, eSetBits, NULL); // Bits accumulate like an event group
+    xTaskNotifyWaitIndexed(task, 1, 0, 0xFFFFFFFFu, &value, 0);
+    printf("Index 1 (eSetBits): got 0x%X, cleared on exit -> 0x%X\n", value, task->ulNotifiedValue[1]);
+
+    xTaskGenericNotify(task, 2, 100, eSetValueWithOverwrite, NULL);
+    xTaskGenericNotify(task, 2, 200, eSetValueWithOverwrite, NULL); // Latest wins
+    bool accepted = xTaskGenericNotify(task, 2, 300, eSetValueWithoutOverwrite, NULL);
+    printf("Index 2: overwrite 100 then 200, then without-overwrite 300 -> %s\n",
+           accepted ? "accepted" : "REJECTED (200 not read yet)");
+    xTaskNotifyWaitIndexed(task, 2, 0, 0, &value, 0);
+    printf("Index 2: task reads %u\n", value);
+    accepted = xTaskGenericNotify(task, 2, 300, eSetValueWithoutOverwrite, NULL);
+    printf("Index 2: without-overwrite 300 after the read -> %s\n", accepted ? "accepted" : "REJECTED");
+
+    printf("\n=== 4. Blocking Wait With Timeout ===\n");
+    xTaskNotifyWaitIndexed(task, 1, 0xFFFFFFFFu, 0, &value, 3); // Block for 3 ticks
+    for (int i = 0; i < 3 && task->is_blocked; i++) task_tick(task, &my_sem);
+    printf("xTaskNotifyWait: %s\n", task->result_ok ? "notified" : "TIMED OUT");
+
+    xTaskNotifyWaitIndexed(task, 1, 0xFFFFFFFFu, 0, &value, 10);
+    task_tick(task, &my_sem);
+    xTaskGenericNotify(task, 1, 0x80, eSetBits, NULL); // Arrives within the timeout
+    printf("xTaskNotifyWait: %s, value 0x%X\n", task->result_ok ? "notified" : "TIMED OUT", task->result_value);
+
+    printf("\n=== 5. Benchmark: Semaphore vs Notification ===\n");
+    run_benchmark();
 
     return 0;
 }
@@ -1,76 +1,364 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <ucontext.h>
+#include <sys/time.h>
 
 /*
  * RTOS Core: The Task Control Block (TCB)
- * 
+ *
  * This struct IS the task. It holds everything the OS needs to know.
- * When we "switch tasks", we are just switching which TCB we are looking at.
+ * When we "switch tasks", we save the registers of the running task on ITS
+ * stack, and load the registers of the next task from ITS stack.
+ *
+ * Here that happens for real, on the host:
+ * - Every task runs its own C function on its own pxStack.
+ * - ucontext backend (portable baseline): getcontext/makecontext/swapcontext.
+ *   Saves ALL registers and the signal mask (= a syscall per switch).
+ * - x86-64 asm backend (fast path): pushes only the callee-saved registers
+ *   (RBX, RBP, R12-R15) on the old stack, stores SP in pxTopOfStack, loads
+ *   the new SP and pops. Exactly what PendSV does on a Cortex-M (R4-R11).
+ * - Cooperative: a task gives up the CPU with taskYIELD().
+ * - Preemptive: SIGALRM plays the SysTick interrupt and switches tasks from
+ *   the signal handler. This uses the ucontext backend, because it must also
+ *   restore the signal mask. Critical sections block SIGALRM (= disable interrupts).
+ *
+ * Build: gcc -O2 tcb_scheduler.c -o tcb_scheduler
  */
 
 // 1. The Stack
-// Each task needs its own stack.
-#define STACK_SIZE 128
+// Each task needs its own stack. (Host C code + printf needs far more than an MCU task.)
+#define STACK_SIZE (16 * 1024)  // In StackType_t words: 64 KB
 typedef uint32_t StackType_t;
 
+#define MAX_TASKS        8
+#define TICK_PERIOD_US   1000   // SIGALRM "SysTick": 1 ms
+#define BENCH_SWITCHES   200000
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define PORT_HAS_ASM_SWITCH 1
+#else
+#define PORT_HAS_ASM_SWITCH 0
+#endif
+
+typedef void (*TaskFunction_t)(void *);
+
+typedef enum { TASK_READY, TASK_DELETED } TaskState_t;
+typedef enum { BACKEND_UCONTEXT, BACKEND_ASM } SwitchBackend_t;
+
 // 2. The TCB
 typedef struct TCB {
-    volatile StackType_t *pxTopOfStack; // Pointer to the last item pushed
+    volatile StackType_t *pxTopOfStack; // Saved SP (asm backend)
     char pcTaskName[16];                // Name for debugging
-    int uxPriority;                     // Priority (0 = Low)
-    StackType_t pxStack[STACK_SIZE];    // The actual stack memory
+    int uxPriority;                     // Priority (0 = Low); round-robin here
+    TaskFunction_t pxTaskCode;
+    void *pvParameters;
+    TaskState_t eState;
+    ucontext_t xContext;                // Saved context (ucontext backend)
+    _Alignas(16) StackType_t pxStack[STACK_SIZE]; // The actual stack memory
 } TCB_t;
 
 // Global pointer to the Currently Running Task
-TCB_t *pxCurrentTCB = NULL;
+TCB_t *volatile pxCurrentTCB = NULL;
+
+static TCB_t *pxTasks[MAX_TASKS];
+static int uxTaskCount = 0;
+static TCB_t xSchedulerTCB = { .pcTaskName = "main" }; // The context that started the scheduler
+static SwitchBackend_t xBackend = BACKEND_UCONTEXT;
+static bool xTrace = true;
+static bool xPreemptive = false;
+static volatile uint64_t ulSwitchCount = 0;
+static volatile uint64_t ulPreemptions = 0;
+static volatile uint32_t xTickCount = 0;
+
+// --- Port layer ---
+
+#if PORT_HAS_ASM_SWITCH
+// void port_asm_switch(volatile StackType_t **save_sp, volatile StackType_t *load_sp)
+// Save callee-saved registers on the current stack, swap SP, restore, return
+// into the new task. Caller-saved registers are already saved by the C caller.
+// (MXCSR and the x87 control word are callee-saved too; no task here changes them.)
+void port_asm_switch(volatile StackType_t **save_sp, volatile StackType_t *load_sp);
+__asm__(
+    ".text\n"
+    ".globl port_asm_switch\n"
+    ".type port_asm_switch, @function\n"
+    "port_asm_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    movq %rsp, (%rdi)\n"   // *save_sp = SP
+    "    movq %rsi, %rsp\n"     // SP = load_sp
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"                 // Pops the new task's PC
+    ".size port_asm_switch, .-port_asm_switch\n"
+);
+#endif
+
+static void port_switch(TCB_t *from, TCB_t *to) {
+    ulSwitchCount++;
+#if PORT_HAS_ASM_SWITCH
+    if (xBackend == BACKEND_ASM) {
+        port_asm_switch(&from->pxTopOfStack, to->pxTopOfStack);
+        return;
+    }
+#endif
+    swapcontext(&from->xContext, &to->xContext);
+}
+
+// Critical section = "disable interrupts" = block the SIGALRM tick
+static sigset_t xTickSignalSet;
+
+void taskENTER_CRITICAL() {
+    sigprocmask(SIG_BLOCK, &xTickSignalSet, NULL);
+}
+
+void taskEXIT_CRITICAL() {
+    sigprocmask(SIG_UNBLOCK, &xTickSignalSet, NULL);
+}
+
+// --- Scheduler ---
 
-// 3. Task Creation (Simplified)
-void CreateTask(TCB_t *tcb, const char *name, int priority) {
-    strcpy(tcb->pcTaskName, name);
+// Pick the next READY task after the current one (round-robin).
+// Nothing left to run -> go back to the context that started the scheduler.
+void vTaskSwitchContext() {
+    TCB_t *prev = pxCurrentTCB;
+    int start = 0;
+    for (int i = 0; i < uxTaskCount; i++) {
+        if (pxTasks[i] == prev) start = i + 1;
+    }
+
+    TCB_t *next = &xSchedulerTCB;
+    for (int n = 0; n < uxTaskCount; n++) {
+        TCB_t *candidate = pxTasks[(start + n) % uxTaskCount];
+        if (candidate->eState == TASK_READY) {
+            next = candidate;
+            break;
+        }
+    }
+    if (next == prev) return;
+
+    if (xTrace) {
+        printf("[Scheduler] Switching from %s (SP: %p) to %s (SP: %p)\n",
+               prev->pcTaskName, (void *)prev->pxTopOfStack, next->pcTaskName, (void *)next->pxTopOfStack);
+    }
+    pxCurrentTCB = next;
+    port_switch(prev, next); // Returns when 'prev' is switched back in
+}
+
+void taskYIELD() {
+    if (!xPreemptive) {
+        vTaskSwitchContext();
+        return;
+    }
+    taskENTER_CRITICAL(); // Don't let the tick switch us halfway through a switch
+    vTaskSwitchContext();
+    taskEXIT_CRITICAL();
+}
+
+// First code every task runs (on its own stack)
+static void prvTaskEntry(void) {
+    TCB_t *self = pxCurrentTCB;
+    if (xBackend == BACKEND_UCONTEXT) taskEXIT_CRITICAL(); // May start from the tick handler
+    self->pxTaskCode(self->pvParameters);
+
+    // Task function returned: delete it and never come back
+    self->eState = TASK_DELETED;
+    if (xTrace) printf("[OS] Task %s finished.\n", self->pcTaskName);
+    taskENTER_CRITICAL();
+    vTaskSwitchContext();
+}
+
+// 3. Task Creation
+void CreateTask(TCB_t *tcb, const char *name, int priority, TaskFunction_t code, void *params) {
+    memset(tcb, 0, sizeof(*tcb));
+    snprintf(tcb->pcTaskName, sizeof(tcb->pcTaskName), "%s", name);
     tcb->uxPriority = priority;
-    
-    // Initialize Stack Pointer to the END of the array (Stack grows down!)
-    tcb->pxTopOfStack = &(tcb->pxStack[STACK_SIZE - 1]);
-    
-    // In a real RTOS, we would "fake" a stack frame here 
-    // (Push PC, LR, R0-R15) so the first context switch works.
-    printf("[OS] Created Task: %s (Priority %d)\n", name, priority);
-}
-
-// 4. The Scheduler (Simplified)
-void vTaskSwitchContext(TCB_t *taskA, TCB_t *taskB) {
-    printf("\n[Scheduler] Switching from %s to %s\n", taskA->pcTaskName, taskB->pcTaskName);
-    
-    // Step 1: Save Context of A (Simulated)
-    // In Assembly: PUSH {R4-R11}
-    // Save the new SP to the TCB
-    printf("  -> Saving Context of %s (SP: %p)\n", taskA->pcTaskName, taskA->pxTopOfStack);
-    
-    // Step 2: Update Current TCB
-    pxCurrentTCB = taskB;
-    
-    // Step 3: Restore Context of B (Simulated)
-    // Load SP from TCB
-    // In Assembly: POP {R4-R11}
-    printf("  -> Restoring Context of %s (SP: %p)\n", taskB->pcTaskName, taskB->pxTopOfStack);
+    tcb->pxTaskCode = code;
+    tcb->pvParameters = params;
+    tcb->eState = TASK_READY;
+
+    // "Fake" the frame the first switch will pop (Stack grows down!):
+    // [ 0 (return addr of prvTaskEntry) | prvTaskEntry | rbp rbx r12 r13 r14 r15 = 0 ]
+    uintptr_t top = ((uintptr_t)&tcb->pxStack[STACK_SIZE]) & ~(uintptr_t)15;
+    uintptr_t *sp = (uintptr_t *)top;
+    *--sp = 0;                         // Fake return address: SP % 16 == 8 on entry, like a call
+    *--sp = (uintptr_t)prvTaskEntry;   // 'ret' jumps here
+    for (int i = 0; i < 6; i++) *--sp = 0;
+    tcb->pxTopOfStack = (volatile StackType_t *)sp;
+
+    // Same task, ucontext flavour. makecontext builds its own first frame at the
+    // top of uc_stack, so keep it below the asm frame above.
+    getcontext(&tcb->xContext);
+    tcb->xContext.uc_stack.ss_sp = tcb->pxStack;
+    tcb->xContext.uc_stack.ss_size = (uintptr_t)sp - (uintptr_t)tcb->pxStack;
+    tcb->xContext.uc_link = NULL;
+    makecontext(&tcb->xContext, prvTaskEntry, 0);
+
+    pxTasks[uxTaskCount++] = tcb;
+    if (xTrace) printf("[OS] Created Task: %s (Priority %d, stack %zu KB)\n", name, priority,
+                       sizeof(tcb->pxStack) / 1024);
+}
+
+static void prvTickHandler(int sig) {
+    (void)sig;
+    xTickCount++;
+    if (pxCurrentTCB == &xSchedulerTCB) return;
+    ulPreemptions++;
+    vTaskSwitchContext(); // Preempt: the interrupted task resumes here later
+}
+
+// Runs tasks until all of them have finished, then returns
+void vTaskStartScheduler(bool preemptive) {
+    sigemptyset(&xTickSignalSet);
+    sigaddset(&xTickSignalSet, SIGALRM);
+
+    if (preemptive) {
+        xBackend = BACKEND_UCONTEXT; // Must save/restore the signal mask too
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = prvTickHandler;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGALRM, &sa, NULL);
+
+        struct itimerval timer = { .it_interval = { 0, TICK_PERIOD_US }, .it_value = { 0, TICK_PERIOD_US } };
+        setitimer(ITIMER_REAL, &timer, NULL);
+    }
+
+    xPreemptive = preemptive;
+    pxCurrentTCB = &xSchedulerTCB;
+    taskENTER_CRITICAL();
+    vTaskSwitchContext();        // Off we go; back here when every task is done
+    taskEXIT_CRITICAL();
+    xPreemptive = false;
+
+    if (preemptive) {
+        struct itimerval off = { 0 };
+        setitimer(ITIMER_REAL, &off, NULL);
+        signal(SIGALRM, SIG_DFL);
+    }
+    uxTaskCount = 0;
+}
+
+// --- Demo 1: cooperative firmware logic ---
+
+static volatile int latest_reading = 0;
+static volatile bool reading_ready = false;
+
+void SensorTask(void *params) {
+    int samples = *(int *)params;
+    for (int i = 1; i <= samples; i++) {
+        latest_reading = 200 + i * 7;  // "Read the ADC"
+        reading_ready = true;
+        printf("  SensorTask: sampled %d\n", latest_reading);
+        taskYIELD();
+    }
+}
+
+void DisplayTask(void *params) {
+    int samples = *(int *)params;
+    for (int shown = 0; shown < samples; ) {
+        if (!reading_ready) {
+            taskYIELD();
+            continue;
+        }
+        reading_ready = false;
+        printf("  DisplayTask: showing %d.%d C\n", latest_reading / 10, latest_reading % 10);
+        shown++;
+    }
+}
+
+// --- Demo 2: preemptive, tasks never yield ---
+
+typedef struct {
+    uint64_t iterations;
+    volatile uint64_t progress;
+} SpinWork_t;
+
+void BusyTask(void *params) {
+    SpinWork_t *work = params;
+    for (uint64_t i = 1; i <= work->iterations; i++) {
+        work->progress = i;
+        if (i % (work->iterations / 4) == 0) {
+            taskENTER_CRITICAL(); // printf is not reentrant: keep the tick out
+            printf("  %s: %3llu%% (tick %u)\n", pxCurrentTCB->pcTaskName,
+                   (unsigned long long)(i * 100 / work->iterations), xTickCount);
+            taskEXIT_CRITICAL();
+        }
+    }
+}
+
+// --- Demo 3: context switch microbenchmark ---
+
+void PingPongTask(void *params) {
+    int rounds = *(int *)params;
+    for (int i = 0; i < rounds; i++) taskYIELD();
+}
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static TCB_t task1, task2, task3;
+
+double benchmark_switch(SwitchBackend_t backend) {
+    int rounds = BENCH_SWITCHES / 2;
+    xTrace = false;
+    xBackend = backend;
+    CreateTask(&task1, "Ping", 1, PingPongTask, &rounds);
+    CreateTask(&task2, "Pong", 1, PingPongTask, &rounds);
+
+    ulSwitchCount = 0;
+    uint64_t start = now_ns();
+    vTaskStartScheduler(false);
+    uint64_t elapsed = now_ns() - start;
+    xTrace = true;
+    return (double)elapsed / (double)ulSwitchCount;
 }
 
 int main() {
-    TCB_t task1, task2;
-    
-    CreateTask(&task1, "SensorTask", 2);
-    CreateTask(&task2, "DisplayTask", 1);
-    
-    // Start running Task 1
-    pxCurrentTCB = &task1;
-    printf("\n[OS] Running: %s\n", pxCurrentTCB->pcTaskName);
-    
-    // Simulate Tick Interrupt -> Switch to Task 2
-    vTaskSwitchContext(&task1, &task2);
-    
-    // Simulate Tick Interrupt -> Switch back to Task 1
-    vTaskSwitchContext(&task2, &task1);
+    int samples = 3;
+
+    printf("=== 1. Cooperative Tasks on Their Own Stacks (%s) ===\n",
+           PORT_HAS_ASM_SWITCH ? "asm switch" : "ucontext");
+    xBackend = PORT_HAS_ASM_SWITCH ? BACKEND_ASM : BACKEND_UCONTEXT;
+    CreateTask(&task1, "SensorTask", 2, SensorTask, &samples);
+    CreateTask(&task2, "DisplayTask", 1, DisplayTask, &samples);
+    vTaskStartScheduler(false);
+    printf("[OS] All tasks done, back in main.\n");
+
+    printf("\n=== 2. Preemptive (SIGALRM tick every %d us) ===\n", TICK_PERIOD_US);
+    xTrace = false;
+    SpinWork_t work[3] = { { .iterations = 60000000 }, { .iterations = 40000000 }, { .iterations = 20000000 } };
+    CreateTask(&task1, "Motor", 3, BusyTask, &work[0]);
+    CreateTask(&task2, "Comms", 2, BusyTask, &work[1]);
+    CreateTask(&task3, "Logger", 1, BusyTask, &work[2]);
+    ulPreemptions = 0;
+    vTaskStartScheduler(true);
+    printf("[OS] Done after %u ticks, %llu preemptions (no task ever yielded).\n",
+           xTickCount, (unsigned long long)ulPreemptions);
+    xTrace = true;
+
+    printf("\n=== 3. Context Switch Cost (%d switches) ===\n", BENCH_SWITCHES);
+    printf("ucontext (swapcontext):   %7.1f ns/switch\n", benchmark_switch(BACKEND_UCONTEXT));
+#if PORT_HAS_ASM_SWITCH
+    printf("asm (callee-saved only):  %7.1f ns/switch\n", benchmark_switch(BACKEND_ASM));
+#endif
 
     return 0;
 }
@@ -1,83 +1,526 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
 
 /*
  * Phase 0: The Interrupt Vector Table
- * 
+ *
  * WHAT: An array of function pointers stored at the beginning of Flash (0x00000000).
  * WHY: When an interrupt fires (e.g., IRQ #1), the CPU looks at index 1 of this table
  *      to find the address of the ISR to execute.
+ *
+ * The Interrupt Controller (NVIC, Cortex-M style):
+ * - Every exception has a PRIORITY. Lower number = more urgent.
+ *   Reset / NMI / HardFault have fixed negative priorities (can't be masked).
+ * - PENDING bitmap: "this IRQ has fired but hasn't started yet".
+ *   ACTIVE bitmap: "this handler has started and hasn't returned yet".
+ * - Execution priority = the most urgent of: active handlers, BASEPRI, PRIMASK.
+ *   A pending IRQ only starts if it is MORE urgent than that (equal = waits).
+ *   BASEPRI = n masks every IRQ with priority >= n (this is what
+ *   taskENTER_CRITICAL() uses in FreeRTOS on Cortex-M3+).
+ * - Preemption / nesting: a more urgent IRQ interrupts a running handler.
+ * - Tail-chaining: when a handler returns and another IRQ is pending, the CPU
+ *   jumps straight to it (~6 cycles) instead of unstacking (~10) and
+ *   stacking again (~12).
+ *
+ * Time is counted in CPU cycles so we can see interrupt LATENCY
+ * (cycles from "IRQ fired" to "first instruction of the handler").
+ *
+ * Latency Instrumentation:
+ * - Every IRQ is timestamped at raise, handler entry and handler exit with the
+ *   simulated cycle counter (the DWT->CYCCNT of a real Cortex-M), so the
+ *   numbers are exact, not sampled.
+ * - Per-exception histograms with log buckets (HDR style): exact below 16,
+ *   then 8 sub-buckets per power of two (<= 12.5% error) up to 2^64.
+ *   Fixed size, O(1) record, percentiles without keeping every sample.
+ * - A sweep runs the same random IRQ load under two priority settings and
+ *   prints p50/p99/p99.9/max. Pass a file name to also dump the histograms as CSV:
+ *   ./vector_table_sim latency.csv
  */
 
+// Exception numbers (Cortex-M): 1-15 are system exceptions, IRQ n is 16 + n
+#define EXC_RESET      1
+#define EXC_NMI        2
+#define EXC_HARDFAULT  3
+#define EXC_SVCALL     11
+#define EXC_PENDSV     14
+#define EXC_SYSTICK    15
+#define EXC_IRQ(n)     (16 + (n))
+#define NUM_IRQS       8
+#define NUM_EXCEPTIONS (16 + NUM_IRQS)
+
+#define IRQ_TIMER2     EXC_IRQ(0)
+#define IRQ_DMA1       EXC_IRQ(1)
+#define IRQ_UART1      EXC_IRQ(2)
+
+// Cycle costs (typical Cortex-M4, zero wait state memory)
+#define CYCLES_ENTRY      12 // Stack R0-R3, R12, LR, PC, xPSR + fetch vector
+#define CYCLES_EXIT       10 // Unstack and return
+#define CYCLES_TAIL_CHAIN 6  // Skip the unstack/restack pair
+
+#define MAX_NESTING       8
+
+#define HIST_LINEAR      16  // Values below this get their own bucket
+#define HIST_SUB_BITS    3   // 8 sub-buckets per power of two
+#define HIST_BUCKETS     (HIST_LINEAR + (64 - 4) * (1 << HIST_SUB_BITS))
+
+#define SWEEP_EVENTS     20000
+
+static bool verbose = true; // Off during the latency sweep
+#define LOG(...) do { if (verbose) printf(__VA_ARGS__); } while (0)
+
+// --- Log-bucket latency histogram ---
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} LatencyHistogram_t;
+
+static int hist_index(uint64_t value) {
+    if (value < HIST_LINEAR) return (int)value;
+    int exp = 63 - __builtin_clzll(value); // >= 4
+    int sub = (int)((value >> (exp - HIST_SUB_BITS)) & ((1 << HIST_SUB_BITS) - 1));
+    return HIST_LINEAR + (exp - 4) * (1 << HIST_SUB_BITS) + sub;
+}
+
+static uint64_t hist_bucket_low(int index) {
+    if (index < HIST_LINEAR) return (uint64_t)index;
+    int exp = (index - HIST_LINEAR) / (1 << HIST_SUB_BITS) + 4;
+    int sub = (index - HIST_LINEAR) % (1 << HIST_SUB_BITS);
+    return (uint64_t)((1 << HIST_SUB_BITS) + sub) << (exp - HIST_SUB_BITS);
+}
+
+static uint64_t hist_bucket_high(int index) {
+    return (index + 1 < HIST_BUCKETS) ? hist_bucket_low(index + 1) - 1 : UINT64_MAX;
+}
+
+void hist_record(LatencyHistogram_t *h, uint64_t value) {
+    h->counts[hist_index(value)]++;
+    h->total++;
+    if (value > h->max) h->max = value;
+}
+
+// Upper edge of the bucket holding the p-th sample (never above the real max)
+uint64_t hist_percentile(const LatencyHistogram_t *h, double p) {
+    if (h->total == 0) return 0;
+    uint64_t rank = (uint64_t)(p * (double)h->total + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t high = hist_bucket_high(i);
+            return (high < h->max) ? high : h->max;
+        }
+    }
+    return h->max;
+}
+
 // Define a function pointer type for ISRs
 typedef void (*ISR_Handler_t)(void);
 
+// One running handler (a level of nesting)
+typedef struct {
+    int exc;
+    uint32_t remaining_cycles; // Handler body cycles still to execute
+    uint64_t raised_at;        // Raise timestamp of THIS activation
+} Frame_t;
+
+typedef struct {
+    uint64_t cycle;              // Current CPU time
+    int8_t priority[NUM_EXCEPTIONS];
+    uint32_t pending;            // Bit n = exception n pending
+    uint32_t active;             // Bit n = exception n active
+    uint8_t basepri;             // 0 = no masking
+    bool primask;                // true = mask everything except NMI/HardFault
+    bool halted;
+
+    Frame_t stack[MAX_NESTING];  // Nested handlers, top = running
+    int depth;
+
+    // Per-exception stats
+    uint64_t raised_at[NUM_EXCEPTIONS];
+    uint32_t entries[NUM_EXCEPTIONS];
+    uint32_t tail_chained[NUM_EXCEPTIONS];
+    uint32_t preemptions[NUM_EXCEPTIONS]; // Times it interrupted another handler
+    uint64_t latency_total[NUM_EXCEPTIONS];
+    uint64_t latency_max[NUM_EXCEPTIONS];
+    LatencyHistogram_t entry_hist[NUM_EXCEPTIONS];    // Raise -> handler entry
+    LatencyHistogram_t response_hist[NUM_EXCEPTIONS]; // Raise -> handler exit
+} NVIC_t;
+
+// A hardware event: exception 'exc' fires at 'cycle' (relative to the run start)
+typedef struct {
+    uint64_t cycle;
+    int exc;
+} IrqEvent_t;
+
+static NVIC_t nvic;
+
 // Simulated ISRs
 void Reset_Handler(void) {
-    printf("[CPU] Executing Reset_Handler (Startup Code)...\n");
+    LOG("[CPU @%4llu] Executing Reset_Handler (Startup Code)...\n", (unsigned long long)nvic.cycle);
 }
 
 void NMI_Handler(void) {
-    printf("[CPU] Executing NMI_Handler (Non-Maskable Interrupt)!\n");
+    LOG("[CPU @%4llu] Executing NMI_Handler (Non-Maskable Interrupt)!\n", (unsigned long long)nvic.cycle);
 }
 
 void HardFault_Handler(void) {
-    printf("[CPU] CRITICAL: HardFault_Handler! System Crashed.\n");
-    while(1); // Trap
+    LOG("[CPU @%4llu] CRITICAL: HardFault_Handler! System Crashed.\n", (unsigned long long)nvic.cycle);
+    nvic.halted = true; // Real HW: while(1); // Trap
 }
 
 void SysTick_Handler(void) {
-    printf("[CPU] SysTick_Handler (OS Tick).\n");
+    LOG("[CPU @%4llu] SysTick_Handler (OS Tick).\n", (unsigned long long)nvic.cycle);
+}
+
+void TIM2_IRQHandler(void) {
+    LOG("[CPU @%4llu] TIM2_IRQHandler (Motor control loop).\n", (unsigned long long)nvic.cycle);
+}
+
+void DMA1_IRQHandler(void) {
+    LOG("[CPU @%4llu] DMA1_IRQHandler (Transfer complete).\n", (unsigned long long)nvic.cycle);
+}
+
+void UART1_IRQHandler(void) {
+    LOG("[CPU @%4llu] UART1_IRQHandler (Byte received).\n", (unsigned long long)nvic.cycle);
 }
 
 // The Vector Table (Simulated)
 // In real hardware, this is placed at 0x00000000 via Linker Script (.isr_vector)
-ISR_Handler_t vector_table[] = {
-    (ISR_Handler_t)0x20001000, // 0: Initial Stack Pointer (MSP) - Not a function!
-    Reset_Handler,             // 1: Reset
-    NMI_Handler,               // 2: NMI
-    HardFault_Handler,         // 3: HardFault
-    0, 0, 0, 0,                // 4-7: Reserved
-    0, 0, 0,                   // 8-10: SVCall, Debug, etc.
-    SysTick_Handler            // 15: SysTick
+ISR_Handler_t vector_table[NUM_EXCEPTIONS] = {
+    [0]             = (ISR_Handler_t)0x20001000, // Initial Stack Pointer (MSP) - Not a function!
+    [EXC_RESET]     = Reset_Handler,
+    [EXC_NMI]       = NMI_Handler,
+    [EXC_HARDFAULT] = HardFault_Handler,
+    // 4-10: MemManage, BusFault, UsageFault, Reserved; 11: SVCall; 12-13: Debug; 14: PendSV
+    [EXC_SYSTICK]   = SysTick_Handler,
+    [IRQ_TIMER2]    = TIM2_IRQHandler,
+    [IRQ_DMA1]      = DMA1_IRQHandler,
+    [IRQ_UART1]     = UART1_IRQHandler,
 };
 
-// Simulate the Hardware Interrupt Controller (NVIC)
-void NVIC_Simulate_Interrupt(int irq_number) {
-    printf("\n[NVIC] Interrupt #%d fired!\n", irq_number);
-    
-    if (irq_number < 0 || irq_number >= sizeof(vector_table)/sizeof(vector_table[0])) {
+// How long each handler body runs (cycles)
+static const uint32_t handler_cycles[NUM_EXCEPTIONS] = {
+    [EXC_RESET] = 100, [EXC_NMI] = 20, [EXC_HARDFAULT] = 10, [EXC_SYSTICK] = 60,
+    [IRQ_TIMER2] = 40, [IRQ_DMA1] = 80, [IRQ_UART1] = 150,
+};
+
+static const char *exception_name(int exc) {
+    switch (exc) {
+    case EXC_RESET:     return "Reset";
+    case EXC_NMI:       return "NMI";
+    case EXC_HARDFAULT: return "HardFault";
+    case EXC_SYSTICK:   return "SysTick";
+    case IRQ_TIMER2:    return "TIM2";
+    case IRQ_DMA1:      return "DMA1";
+    case IRQ_UART1:     return "UART1";
+    default:            return "?";
+    }
+}
+
+void NVIC_Init() {
+    nvic = (NVIC_t){ 0 };
+    nvic.priority[EXC_RESET] = -3; // Fixed, can't be changed
+    nvic.priority[EXC_NMI] = -2;
+    nvic.priority[EXC_HARDFAULT] = -1;
+}
+
+void NVIC_SetPriority(int exc, int8_t priority) {
+    if (exc > EXC_HARDFAULT) nvic.priority[exc] = priority;
+}
+
+// The priority level below which nothing may start right now
+static int execution_priority() {
+    int prio = 256; // Thread mode, nothing masked
+    for (int i = 0; i < nvic.depth; i++) {
+        int p = nvic.priority[nvic.stack[i].exc];
+        if (p < prio) prio = p;
+    }
+    if (nvic.basepri != 0 && nvic.basepri < prio) prio = nvic.basepri;
+    if (nvic.primask && prio > 0) prio = 0;
+    return prio;
+}
+
+// Most urgent pending exception (lowest priority value, then lowest number), or -1
+static int highest_pending() {
+    int best = -1;
+    for (uint32_t bits = nvic.pending; bits != 0; bits &= bits - 1) {
+        int exc = __builtin_ctz(bits);
+        if (best < 0 || nvic.priority[exc] < nvic.priority[best]) best = exc;
+    }
+    return best;
+}
+
+// The hardware line went active at 'when' (may be a little in the past,
+// e.g. it fired while the CPU was busy stacking for another exception)
+static void set_pending_at(int exc, uint64_t when) {
+    if (exc <= 0 || exc >= NUM_EXCEPTIONS) {
         printf("[CPU] Error: Invalid IRQ number.\n");
         return;
     }
+    if (nvic.pending & (1u << exc)) return; // Already pending: the two events merge into one!
+    nvic.pending |= 1u << exc;
+    nvic.raised_at[exc] = when;
+    LOG("[NVIC @%4llu] %s pending (prio %d)\n", (unsigned long long)when,
+           exception_name(exc), nvic.priority[exc]);
+}
+
+void NVIC_SetPendingIRQ(int exc) {
+    set_pending_at(exc, nvic.cycle);
+}
+
+// Start 'exc' now: stacking (or tail-chain), then the first instruction of the handler
+static void enter_exception(int exc, bool tail_chain) {
+    bool preempting = !tail_chain && nvic.depth > 0;
+    nvic.cycle += tail_chain ? CYCLES_TAIL_CHAIN : CYCLES_ENTRY;
+    nvic.pending &= ~(1u << exc);
+    nvic.active |= 1u << exc;
 
-    // 1. Fetch the address from the Vector Table
-    ISR_Handler_t handler = vector_table[irq_number];
-    
-    // 2. Check if handler exists
+    uint64_t latency = nvic.cycle - nvic.raised_at[exc];
+    nvic.entries[exc]++;
+    nvic.latency_total[exc] += latency;
+    if (latency > nvic.latency_max[exc]) nvic.latency_max[exc] = latency;
+    hist_record(&nvic.entry_hist[exc], latency);
+    if (tail_chain) nvic.tail_chained[exc]++;
+    if (preempting) {
+        nvic.preemptions[exc]++;
+        LOG("[NVIC @%4llu] %s PREEMPTS %s (nesting depth %d)\n", (unsigned long long)nvic.cycle,
+               exception_name(exc), exception_name(nvic.stack[nvic.depth - 1].exc), nvic.depth + 1);
+    } else if (tail_chain) {
+        LOG("[NVIC @%4llu] Tail-chain into %s (no unstack/restack)\n",
+               (unsigned long long)nvic.cycle, exception_name(exc));
+    }
+    LOG("[NVIC @%4llu] %s entry latency: %llu cycles\n", (unsigned long long)nvic.cycle,
+           exception_name(exc), (unsigned long long)latency);
+
+    nvic.stack[nvic.depth++] = (Frame_t){ .exc = exc, .remaining_cycles = handler_cycles[exc],
+                                          .raised_at = nvic.raised_at[exc] };
+
+    // Fetch the address from the Vector Table and jump to the handler
+    ISR_Handler_t handler = vector_table[exc];
     if (handler == 0) {
-        printf("[CPU] Error: No handler defined for IRQ #%d (Default Handler?)\n", irq_number);
         // In real HW, this usually falls through to a Default_Handler (infinite loop)
+        printf("[CPU] Error: No handler defined for exception #%d (Default Handler?)\n", exc);
         return;
     }
-    
-    // 3. Jump to the Handler
-    // (In real HW, this involves stacking R0-R3, R12, LR, PC, xPSR first)
     handler();
 }
 
-int main() {
+// Start everything that is allowed to run right now
+static void dispatch(bool tail_chain) {
+    int exc;
+    while (!nvic.halted && (exc = highest_pending()) >= 0 && nvic.priority[exc] < execution_priority()) {
+        if (nvic.depth == MAX_NESTING) return;
+        enter_exception(exc, tail_chain);
+        tail_chain = false;
+    }
+}
+
+// The running handler finished its body: return, or tail-chain into the next one
+static void exit_exception() {
+    Frame_t done = nvic.stack[--nvic.depth];
+    nvic.active &= ~(1u << done.exc);
+    hist_record(&nvic.response_hist[done.exc], nvic.cycle - done.raised_at);
+    LOG("[NVIC @%4llu] %s returns\n", (unsigned long long)nvic.cycle, exception_name(done.exc));
+
+    int next = highest_pending();
+    if (next >= 0 && nvic.priority[next] < execution_priority()) {
+        dispatch(true);
+        return;
+    }
+    nvic.cycle += CYCLES_EXIT; // Unstack: back to the preempted handler or thread mode
+}
+
+// Run the CPU: 'events' fire at their cycle (relative to now). Stops when idle.
+void NVIC_Run(const IrqEvent_t *events, int count) {
+    uint64_t start = nvic.cycle;
+    int next_event = 0;
+
+    dispatch(false);
+    while (!nvic.halted) {
+        uint64_t event_at = (next_event < count) ? start + events[next_event].cycle : UINT64_MAX;
+        uint64_t done_at = (nvic.depth > 0) ? nvic.cycle + nvic.stack[nvic.depth - 1].remaining_cycles
+                                            : UINT64_MAX;
+        if (event_at == UINT64_MAX && done_at == UINT64_MAX) break; // Idle, nothing left
+
+        if (event_at < done_at) {
+            // The hardware raises an IRQ while the current handler (or thread) runs
+            if (event_at > nvic.cycle) {
+                if (nvic.depth > 0) nvic.stack[nvic.depth - 1].remaining_cycles -= (uint32_t)(event_at - nvic.cycle);
+                nvic.cycle = event_at;
+            }
+            set_pending_at(events[next_event++].exc, event_at);
+            dispatch(false);
+        } else {
+            nvic.cycle = done_at;
+            nvic.stack[nvic.depth - 1].remaining_cycles = 0;
+            exit_exception();
+        }
+    }
+}
+
+// Fire one interrupt and run until the CPU is idle again
+void NVIC_Simulate_Interrupt(int exc) {
+    LOG("\n[NVIC] Interrupt #%d fired!\n", exc);
+    IrqEvent_t ev = { .cycle = 0, .exc = exc };
+    NVIC_Run(&ev, 1);
+}
+
+// Mask IRQs with priority >= level (0 = unmask). Unmasking may start pending IRQs.
+void __set_BASEPRI(uint8_t level) {
+    nvic.basepri = level;
+    LOG("[CPU @%4llu] BASEPRI = %u\n", (unsigned long long)nvic.cycle, level);
+    NVIC_Run(NULL, 0);
+}
+
+void print_nvic_stats() {
+    printf("\n%-10s %5s %8s %8s %8s %9s %9s\n", "Exception", "Prio", "Entries", "Preempt",
+           "TailChn", "AvgLat", "MaxLat");
+    for (int exc = 1; exc < NUM_EXCEPTIONS; exc++) {
+        if (nvic.entries[exc] == 0) continue;
+        printf("%-10s %5d %8u %8u %8u %9.1f %9llu\n", exception_name(exc), nvic.priority[exc],
+               nvic.entries[exc], nvic.preemptions[exc], nvic.tail_chained[exc],
+               (double)nvic.latency_total[exc] / nvic.entries[exc],
+               (unsigned long long)nvic.latency_max[exc]);
+    }
+    printf("(latency in cycles: IRQ fired -> first handler instruction)\n");
+}
+
+// --- Latency sweep: same random IRQ load, different priority settings ---
+
+static uint32_t rng_state = 12345;
+static uint32_t rng_next() {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+static int compare_events(const void *a, const void *b) {
+    uint64_t x = ((const IrqEvent_t *)a)->cycle, y = ((const IrqEvent_t *)b)->cycle;
+    return (x > y) - (x < y);
+}
+
+// TIM2 every 400 cycles, DMA1 and UART1 at random (UART1 sometimes in bursts of 3)
+static int build_load(IrqEvent_t *events, int count) {
+    uint64_t now = 0, next_timer = 0;
+    int n = 0;
+    rng_state = 12345; // Same load every time
+    while (n < count) {
+        now += 60 + rng_next() % 300;
+        while (next_timer <= now && n < count) {
+            events[n++] = (IrqEvent_t){ .cycle = next_timer, .exc = IRQ_TIMER2 };
+            next_timer += 400;
+        }
+        uint32_t r = rng_next() % 4;
+        int burst = (r == 0) ? 3 : 1;
+        for (int b = 0; b < burst && n < count; b++) {
+            events[n++] = (IrqEvent_t){ .cycle = now + b * 30, .exc = (r == 3) ? IRQ_DMA1 : IRQ_UART1 };
+        }
+    }
+    qsort(events, n, sizeof(IrqEvent_t), compare_events);
+    return n;
+}
+
+static void latency_dump_csv(FILE *f, const char *config) {
+    for (int exc = 1; exc < NUM_EXCEPTIONS; exc++) {
+        const LatencyHistogram_t *hists[2] = { &nvic.entry_hist[exc], &nvic.response_hist[exc] };
+        const char *metrics[2] = { "entry", "response" };
+        for (int m = 0; m < 2; m++) {
+            for (int i = 0; i < HIST_BUCKETS; i++) {
+                if (hists[m]->counts[i] == 0) continue;
+                fprintf(f, "%s,%s,%s,%llu,%llu,%llu\n", config, exception_name(exc), metrics[m],
+                        (unsigned long long)hist_bucket_low(i), (unsigned long long)hist_bucket_high(i),
+                        (unsigned long long)hists[m]->counts[i]);
+            }
+        }
+    }
+}
+
+void run_latency_sweep(const char *config, int8_t uart_priority, FILE *csv) {
+    static IrqEvent_t events[SWEEP_EVENTS];
+    int n = build_load(events, SWEEP_EVENTS);
+
+    NVIC_Init();
+    NVIC_SetPriority(IRQ_TIMER2, 1);
+    NVIC_SetPriority(IRQ_DMA1, 2);
+    NVIC_SetPriority(IRQ_UART1, uart_priority);
+    verbose = false;
+    NVIC_Run(events, n);
+    verbose = true;
+
+    printf("\n[%s] UART1 prio %d, %d IRQs over %llu cycles\n", config, uart_priority, n,
+           (unsigned long long)nvic.cycle);
+    printf("%-6s %-9s %8s %8s %8s %8s\n", "IRQ", "Metric", "p50", "p99", "p99.9", "max");
+    for (int exc = IRQ_TIMER2; exc <= IRQ_UART1; exc++) {
+        const LatencyHistogram_t *hists[2] = { &nvic.entry_hist[exc], &nvic.response_hist[exc] };
+        const char *metrics[2] = { "entry", "response" };
+        for (int m = 0; m < 2; m++) {
+            printf("%-6s %-9s %8llu %8llu %8llu %8llu\n", exception_name(exc), metrics[m],
+                   (unsigned long long)hist_percentile(hists[m], 0.50),
+                   (unsigned long long)hist_percentile(hists[m], 0.99),
+                   (unsigned long long)hist_percentile(hists[m], 0.999),
+                   (unsigned long long)hists[m]->max);
+        }
+    }
+    if (csv != NULL) latency_dump_csv(csv, config);
+}
+
+int main(int argc, char **argv) {
     printf("=== Interrupt Vector Table Simulation ===\n");
     printf("Vector Table Address: %p\n", (void*)vector_table);
-    
+
+    NVIC_Init();
+    NVIC_SetPriority(EXC_SYSTICK, 6);
+    NVIC_SetPriority(IRQ_TIMER2, 1); // Most urgent peripheral
+    NVIC_SetPriority(IRQ_DMA1, 2);
+    NVIC_SetPriority(IRQ_UART1, 3);
+
     // 1. Simulate Power On Reset
-    NVIC_Simulate_Interrupt(1); // Reset_Handler
-    
+    NVIC_Simulate_Interrupt(EXC_RESET); // Reset_Handler
+
     // 2. Simulate OS Tick
-    NVIC_Simulate_Interrupt(15); // SysTick
-    
-    // 3. Simulate a Crash
-    NVIC_Simulate_Interrupt(3); // HardFault
+    NVIC_Simulate_Interrupt(EXC_SYSTICK); // SysTick
+
+    // 3. Preemption: TIM2 (prio 1) interrupts UART1 (prio 3) which interrupts SysTick (prio 6)
+    printf("\n--- Preemption & Nesting ---\n");
+    IrqEvent_t nesting[] = { { 0, EXC_SYSTICK }, { 30, IRQ_UART1 }, { 60, IRQ_TIMER2 } };
+    NVIC_Run(nesting, 3);
+
+    // 4. Tail-chaining: UART1 and DMA1 fire while TIM2 runs -> back-to-back, no restack
+    printf("\n--- Tail-Chaining ---\n");
+    IrqEvent_t chain[] = { { 0, IRQ_TIMER2 }, { 10, IRQ_UART1 }, { 20, IRQ_DMA1 } };
+    NVIC_Run(chain, 3);
+
+    // 5. BASEPRI masking (critical section): prio >= 2 must wait
+    printf("\n--- BASEPRI Masking ---\n");
+    __set_BASEPRI(2);
+    IrqEvent_t masked[] = { { 0, IRQ_UART1 }, { 5, IRQ_DMA1 }, { 10, IRQ_TIMER2 } };
+    NVIC_Run(masked, 3); // Only TIM2 (prio 1) gets through
+    __set_BASEPRI(0);    // UART1 and DMA1 run now (their latency includes the masked time)
+
+    print_nvic_stats();
+
+    // 6. Latency histograms: does making UART1 more urgent hurt the motor loop (TIM2)?
+    printf("\n--- Latency Sweep (cycles) ---\n");
+    FILE *csv = NULL;
+    if (argc > 1) {
+        csv = fopen(argv[1], "w");
+        if (csv == NULL) perror(argv[1]);
+        else fprintf(csv, "config,irq,metric,bucket_low,bucket_high,count\n");
+    }
+    run_latency_sweep("timer-first", 3, csv);
+    run_latency_sweep("uart-first", 0, csv);
+    if (csv != NULL) {
+        fclose(csv);
+        printf("Histograms written to %s\n", argv[1]);
+    }
+
+    // 7. Simulate a Crash
+    NVIC_Init();
+    NVIC_Simulate_Interrupt(EXC_HARDFAULT); // HardFault
 
     return 0;
 }